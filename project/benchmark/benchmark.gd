@@ -0,0 +1,400 @@
+extends Node
+
+# Headless benchmark / stress test for the Voxel storage.
+#
+# Run with (or through `scons benchmark`):
+#   godot --headless --path project res://benchmark/benchmark.tscn -- --output=bench_output.json --seed=1234
+#
+# Every workload is seeded so runs are reproducible, and the results are printed (and optionally written)
+# as JSON so they can be diffed between commits to catch regressions.
+
+const STORAGE_SIZE := 256
+const CHUNK_SIZE := 32
+
+var seed_value := 1234
+var output_path := ""
+# Checks that failed within the workloads, any of them makes the benchmark exit with an error.
+var failures: Array[String] = []
+
+func _ready() -> void:
+	_parse_arguments()
+
+	var results := []
+	results.append(_run_workload("random_single_voxel_writes", _random_single_voxel_writes))
+	results.append(_run_workload("bulk_fill", _bulk_fill))
+	results.append(_run_workload("sparse_carve", _sparse_carve))
+	results.append(_run_workload("multi_attribute", _multi_attribute))
+	results.append(_run_workload("brush_sphere_union", _brush_sphere_union))
+	results.append(_run_workload("brush_box_subtract", _brush_box_subtract, _make_filled_occupancy_storage))
+	results.append(_run_workload("brush_capsule_union", _brush_capsule_union))
+	results.append(_run_workload("brush_noise_smooth_blend", _brush_noise_smooth_blend, _make_filled_occupancy_storage))
+	results.append(_run_workload("brush_sphere_intersect", _brush_sphere_intersect, _make_filled_occupancy_storage))
+	results.append(_run_workload("connected_components", _connected_components, _make_filled_occupancy_storage))
+	results.append(_run_workload("connected_components_edit_region", _connected_components_edit_region, _make_filled_occupancy_storage))
+	results.append(_run_workload("delta_round_trip", _delta_round_trip, _make_filled_occupancy_storage))
+	_check_connected_components_fixture()
+
+	var report := {
+		"seed": seed_value,
+		"storage_size": STORAGE_SIZE,
+		"chunk_size": CHUNK_SIZE,
+		"workloads": results,
+		"peak_rss_bytes": _get_peak_rss(),
+	}
+	var json := JSON.stringify(report, "\t")
+	print(json)
+
+	if not output_path.is_empty():
+		var file := FileAccess.open(output_path, FileAccess.WRITE)
+		if file:
+			file.store_string(json)
+		else:
+			push_error("Failed to open benchmark output file \"%s\"." % output_path)
+
+	for failure in failures:
+		push_error("Benchmark check failed: %s" % failure)
+	get_tree().quit(1 if not failures.is_empty() else 0)
+
+func _check(p_condition: bool, p_message: String) -> bool:
+	if not p_condition:
+		failures.append(p_message)
+	return p_condition
+
+func _parse_arguments() -> void:
+	for argument in OS.get_cmdline_user_args():
+		if argument.begins_with("--output="):
+			output_path = argument.trim_prefix("--output=")
+		elif argument.begins_with("--seed="):
+			seed_value = argument.trim_prefix("--seed=").to_int()
+
+# Runs a single workload and wraps its result with the timing / memory information.
+# The workload function gets a seeded RNG and returns a Dictionary containing at least "storage" and "voxels".
+# When a setup function is given, it creates the storage the workload gets as its second argument, outside of the timing.
+func _run_workload(p_name: String, p_workload: Callable, p_setup := Callable()) -> Dictionary:
+	var rng := RandomNumberGenerator.new()
+	rng.seed = seed_value
+
+	var arguments := [rng]
+	if p_setup.is_valid():
+		arguments.append(p_setup.call(rng))
+
+	var peak_rss_before := _get_peak_rss()
+	var start_usec := Time.get_ticks_usec()
+	var result: Dictionary = p_workload.callv(arguments)
+	var elapsed_usec := Time.get_ticks_usec() - start_usec
+
+	var storage: DynamicVoxelStorage = result["storage"]
+	var voxels: int = result["voxels"]
+	# Anything else the workload returned is reported as is.
+	var extra := {}
+	for key in result:
+		if key != "storage" and key != "voxels":
+			extra[key] = result[key]
+	return {
+		"name": p_name,
+		"voxels": voxels,
+		"total_ms": elapsed_usec / 1000.0,
+		"ns_per_voxel": (elapsed_usec * 1000.0) / max(voxels, 1),
+		"voxels_per_second": voxels / max(elapsed_usec / 1000000.0, 0.000001),
+		"chunks_allocated": storage.get_allocated_chunk_count(),
+		"reusable_chunks": storage.get_reusable_chunk_count(),
+		# How far this workload pushed the (process wide, never decreasing) peak up, 0 if it stayed below an earlier one.
+		"peak_rss_growth_bytes": _get_peak_rss() - peak_rss_before,
+		"statistics": storage.get_statistics(),
+		"extra": extra,
+	}
+
+func _make_descriptor(p_name: String, p_type: VoxelAttributeDescriptor.Type, p_num_components: int) -> VoxelAttributeDescriptor:
+	var descriptor := VoxelAttributeDescriptor.new()
+	descriptor.name = p_name
+	descriptor.type = p_type
+	descriptor.num_components = p_num_components
+	descriptor.component_size = descriptor.get_minimum_component_size()
+	return descriptor
+
+func _make_storage(p_descriptors: Array[VoxelAttributeDescriptor]) -> DynamicVoxelStorage:
+	var attribute_object := VoxelAttributeObject.new()
+	attribute_object.descriptors = p_descriptors
+
+	var storage := DynamicVoxelStorage.new()
+	storage.set_voxel_attribute_object(attribute_object)
+	storage.resize_and_clear(STORAGE_SIZE, STORAGE_SIZE, STORAGE_SIZE, CHUNK_SIZE)
+	return storage
+
+func _make_occupancy_storage() -> DynamicVoxelStorage:
+	var descriptors: Array[VoxelAttributeDescriptor] = [
+		_make_descriptor("occupancy", VoxelAttributeDescriptor.TYPE_INTEGER8, 1),
+	]
+	return _make_storage(descriptors)
+
+# Random writes scattered over the whole volume, the worst case for chunk allocation.
+func _random_single_voxel_writes(p_rng: RandomNumberGenerator) -> Dictionary:
+	var storage := _make_occupancy_storage()
+	var count := 200000
+	for i in count:
+		storage.set_voxel_attribute_component_u8_unchecked(0,
+				p_rng.randi_range(0, STORAGE_SIZE - 1),
+				p_rng.randi_range(0, STORAGE_SIZE - 1),
+				p_rng.randi_range(0, STORAGE_SIZE - 1),
+				0, p_rng.randi_range(1, 255))
+	return { "storage": storage, "voxels": count }
+
+# Fills a solid block of voxels in memory order.
+func _bulk_fill(_p_rng: RandomNumberGenerator) -> Dictionary:
+	var storage := _make_occupancy_storage()
+	var size := 96
+	for z in size:
+		for y in size:
+			for x in size:
+				storage.set_voxel_attribute_component_u8_unchecked(0, x, y, z, 0, 255)
+	return { "storage": storage, "voxels": size * size * size }
+
+# Repeatedly fills and clears single voxels in random chunks, so that chunks are constantly
+# freed into (and pulled back out of) the reusable chunk queue.
+func _sparse_carve(p_rng: RandomNumberGenerator) -> Dictionary:
+	var storage := _make_occupancy_storage()
+	var count := 100000
+	var chunks_per_axis := STORAGE_SIZE / CHUNK_SIZE
+	for i in count:
+		var x := p_rng.randi_range(0, chunks_per_axis - 1) * CHUNK_SIZE + p_rng.randi_range(0, 3)
+		var y := p_rng.randi_range(0, chunks_per_axis - 1) * CHUNK_SIZE + p_rng.randi_range(0, 3)
+		var z := p_rng.randi_range(0, chunks_per_axis - 1) * CHUNK_SIZE + p_rng.randi_range(0, 3)
+		storage.set_voxel_attribute_component_u8_unchecked(0, x, y, z, 0, 1)
+		storage.set_voxel_attribute_component_u8_unchecked(0, x, y, z, 0, 0)
+	return { "storage": storage, "voxels": count * 2 }
+
+# Writes every attribute of a typical multi-attribute schema (occupancy, color and density).
+func _multi_attribute(p_rng: RandomNumberGenerator) -> Dictionary:
+	var descriptors: Array[VoxelAttributeDescriptor] = [
+		_make_descriptor("occupancy", VoxelAttributeDescriptor.TYPE_INTEGER8, 1),
+		_make_descriptor("color", VoxelAttributeDescriptor.TYPE_INTEGER8, 4),
+		_make_descriptor("density", VoxelAttributeDescriptor.TYPE_FLOAT32, 1),
+	]
+	var storage := _make_storage(descriptors)
+	var count := 100000
+	for i in count:
+		var x := p_rng.randi_range(0, STORAGE_SIZE - 1)
+		var y := p_rng.randi_range(0, STORAGE_SIZE - 1)
+		var z := p_rng.randi_range(0, STORAGE_SIZE - 1)
+		storage.set_voxel_attribute_component_u8_unchecked(0, x, y, z, 0, 1)
+		storage.set_voxel_attribute_v4u8_unchecked(1, x, y, z,
+				Vector4i(p_rng.randi_range(0, 255), p_rng.randi_range(0, 255), p_rng.randi_range(0, 255), 255))
+		storage.set_voxel_attribute_component_f32_unchecked(2, x, y, z, 0, p_rng.randf())
+	return { "storage": storage, "voxels": count }
+
+func _make_brush(p_shape: VoxelBrush.Shape, p_operation: VoxelBrush.Operation) -> VoxelBrush:
+	var brush := VoxelBrush.new()
+	brush.shape = p_shape
+	brush.operation = p_operation
+	brush.value = 255
+	brush.falloff = 2
+	return brush
+
+func _random_position(p_rng: RandomNumberGenerator) -> Vector3:
+	return Vector3(
+			p_rng.randf_range(0, STORAGE_SIZE),
+			p_rng.randf_range(0, STORAGE_SIZE),
+			p_rng.randf_range(0, STORAGE_SIZE))
+
+# Applies "p_count" brushes with random positions (and radii), returning the amount of voxels they wrote.
+func _apply_random_brushes(p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage, p_brush: VoxelBrush, p_count: int) -> int:
+	var voxels := 0
+	for i in p_count:
+		p_brush.position = _random_position(p_rng)
+		p_brush.end_position = p_brush.position + Vector3(p_rng.randf_range(-48, 48), p_rng.randf_range(-48, 48), p_rng.randf_range(-48, 48))
+		p_brush.radius = p_rng.randf_range(8, 48)
+		p_brush.extents = Vector3(p_brush.radius, p_brush.radius * 0.5, p_brush.radius)
+		voxels += p_storage.apply_brush(p_brush, 0)
+	return voxels
+
+# Fills a storage with some large spheres, so that the destructive brushes have something to work on.
+func _make_filled_occupancy_storage(p_rng: RandomNumberGenerator) -> DynamicVoxelStorage:
+	var storage := _make_occupancy_storage()
+	_apply_random_brushes(p_rng, storage, _make_brush(VoxelBrush.SHAPE_SPHERE, VoxelBrush.OPERATION_UNION), 16)
+	storage.reset_statistics_counters()
+	return storage
+
+func _brush_sphere_union(p_rng: RandomNumberGenerator) -> Dictionary:
+	var storage := _make_occupancy_storage()
+	var brush := _make_brush(VoxelBrush.SHAPE_SPHERE, VoxelBrush.OPERATION_UNION)
+	return { "storage": storage, "voxels": _apply_random_brushes(p_rng, storage, brush, 64) }
+
+func _brush_box_subtract(p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage) -> Dictionary:
+	var storage := p_storage
+	var brush := _make_brush(VoxelBrush.SHAPE_BOX, VoxelBrush.OPERATION_SUBTRACT)
+	return { "storage": storage, "voxels": _apply_random_brushes(p_rng, storage, brush, 64) }
+
+func _brush_capsule_union(p_rng: RandomNumberGenerator) -> Dictionary:
+	var storage := _make_occupancy_storage()
+	var brush := _make_brush(VoxelBrush.SHAPE_CAPSULE, VoxelBrush.OPERATION_UNION)
+	return { "storage": storage, "voxels": _apply_random_brushes(p_rng, storage, brush, 64) }
+
+func _brush_noise_smooth_blend(p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage) -> Dictionary:
+	var storage := p_storage
+	var brush := _make_brush(VoxelBrush.SHAPE_SPHERE, VoxelBrush.OPERATION_SMOOTH_BLEND)
+	var noise := FastNoiseLite.new()
+	noise.seed = seed_value
+	brush.noise = noise
+	brush.noise_strength = 4
+	return { "storage": storage, "voxels": _apply_random_brushes(p_rng, storage, brush, 16) }
+
+func _brush_sphere_intersect(p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage) -> Dictionary:
+	var storage := p_storage
+	var brush := _make_brush(VoxelBrush.SHAPE_SPHERE, VoxelBrush.OPERATION_INTERSECT)
+	return { "storage": storage, "voxels": _apply_random_brushes(p_rng, storage, brush, 4) }
+
+# Labels the whole storage and extracts every component.
+func _connected_components(_p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage) -> Dictionary:
+	var components := p_storage.find_connected_components(0, Vector3i(), Vector3i(STORAGE_SIZE, STORAGE_SIZE, STORAGE_SIZE), true)
+	# Every occupied voxel belongs to exactly one component.
+	var component_voxels := _check_components("connected_components", components)
+	_check(component_voxels == p_storage.get_occupied_voxel_count(),
+			"connected_components: the components hold %d voxels, but the storage %d" % [component_voxels, p_storage.get_occupied_voxel_count()])
+	return {
+		"storage": p_storage,
+		"voxels": STORAGE_SIZE * STORAGE_SIZE * STORAGE_SIZE,
+		"components": components.size(),
+	}
+
+# Carves through the storage with a few boxes (an "explosion"), then only labels around the carved region.
+func _connected_components_edit_region(p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage) -> Dictionary:
+	p_storage.clear_edit_region()
+	var brush := _make_brush(VoxelBrush.SHAPE_BOX, VoxelBrush.OPERATION_SUBTRACT)
+	_apply_random_brushes(p_rng, p_storage, brush, 4)
+
+	var region := p_storage.get_edit_region()
+	var components := p_storage.find_connected_components_in_edit_region(0, 8, true)
+	_check_components("connected_components_edit_region", components)
+	return {
+		"storage": p_storage,
+		"voxels": int(region.grow(8).get_volume()),
+		"components": components.size(),
+	}
+
+# Checks that components are sorted largest first and that every extracted storage holds exactly its component.
+# Returns the total amount of voxels of the components.
+func _check_components(p_name: String, p_components: Array) -> int:
+	var total := 0
+	var previous_count := -1
+	for component in p_components:
+		var voxel_count: int = component["voxel_count"]
+		var storage: DynamicVoxelStorage = component["storage"]
+		_check(previous_count < 0 or voxel_count <= previous_count, "%s: components aren't sorted largest first" % p_name)
+		_check(storage.get_occupied_voxel_count() == voxel_count,
+				"%s: an extracted component holds %d voxels instead of %d" % [p_name, storage.get_occupied_voxel_count(), voxel_count])
+		previous_count = voxel_count
+		total += voxel_count
+	return total
+
+# Labels two boxes that each cross chunk borders, but don't touch each other, so they have to come out as exactly two components.
+func _check_connected_components_fixture() -> void:
+	var storage := _make_occupancy_storage()
+	var boxes := [
+		[Vector3i(10, 10, 10), Vector3i(40, 20, 20)],
+		[Vector3i(20, 30, 30), Vector3i(30, 50, 50)],
+	]
+	for box in boxes:
+		var from: Vector3i = box[0]
+		var to: Vector3i = box[1]
+		for z in range(from.z, to.z):
+			for y in range(from.y, to.y):
+				for x in range(from.x, to.x):
+					storage.set_voxel_attribute_component_u8_unchecked(0, x, y, z, 0, 1)
+
+	var components := storage.find_connected_components(0, Vector3i(), Vector3i(STORAGE_SIZE, STORAGE_SIZE, STORAGE_SIZE), true)
+	_check_components("connected_components_fixture", components)
+	if _check(components.size() == 2, "connected_components_fixture: found %d components instead of 2" % components.size()):
+		_check(components[0]["voxel_count"] == 4000 and components[1]["voxel_count"] == 3000,
+				"connected_components_fixture: wrong component sizes (%d, %d)" % [components[0]["voxel_count"], components[1]["voxel_count"]])
+
+# Replicates a storage into a second one with a full delta, then a few edits later with an incremental delta,
+# and checks that both end up holding the same data, and that broken or out of sequence deltas are rejected.
+func _delta_round_trip(p_rng: RandomNumberGenerator, p_storage: DynamicVoxelStorage) -> Dictionary:
+	var replica := _make_occupancy_storage()
+
+	var full_delta := p_storage.encode_delta(0)
+	var start_usec := Time.get_ticks_usec()
+	var full_error := replica.apply_delta(full_delta)
+	var full_decode_usec := Time.get_ticks_usec() - start_usec
+	_check(full_error == OK, "delta_round_trip: applying the full delta failed with error %d" % full_error)
+	var full_decoded_voxels: int = replica.get_statistics()["voxel_writes"]
+
+	var version := p_storage.get_version()
+	var writes_before: int = p_storage.get_statistics()["voxel_writes"]
+	for i in 1000:
+		p_storage.set_voxel_attribute_component_u8_unchecked(0,
+				p_rng.randi_range(0, STORAGE_SIZE - 1),
+				p_rng.randi_range(0, STORAGE_SIZE - 1),
+				p_rng.randi_range(0, STORAGE_SIZE - 1),
+				0, p_rng.randi_range(0, 255))
+	_apply_random_brushes(p_rng, p_storage, _make_brush(VoxelBrush.SHAPE_SPHERE, VoxelBrush.OPERATION_SUBTRACT), 4)
+	var edits: int = p_storage.get_statistics()["voxel_writes"] - writes_before
+
+	var edit_delta := p_storage.encode_delta(version)
+	replica.reset_statistics_counters()
+	start_usec = Time.get_ticks_usec()
+	var edit_error := replica.apply_delta(edit_delta)
+	var edit_decode_usec := Time.get_ticks_usec() - start_usec
+	var edit_decoded_voxels: int = replica.get_statistics()["voxel_writes"]
+	_check(edit_error == OK, "delta_round_trip: applying the edit delta failed with error %d" % edit_error)
+
+	var hashes_match := p_storage.get_voxel_data_hash() == replica.get_voxel_data_hash()
+	_check(hashes_match, "delta_round_trip: the replica doesn't hold the same data as the source")
+	_check(replica.get_applied_delta_version() == p_storage.get_version(),
+			"delta_round_trip: the replica isn't at the version of the source")
+
+	# These are expected to print errors.
+	_check(replica.apply_delta(full_delta) == ERR_INVALID_DATA, "delta_round_trip: an out of sequence delta was applied")
+	var oversized_delta := PackedByteArray([0x56, 0x44, 0x4C, 0x54, 1, 1, 0xFF, 0xFF, 0xFF, 0xFF])
+	_check(replica.apply_delta(oversized_delta) == ERR_INVALID_DATA, "delta_round_trip: a delta with an oversized payload wasn't rejected")
+	_check(replica.get_voxel_data_hash() == p_storage.get_voxel_data_hash(), "delta_round_trip: a rejected delta modified the replica")
+	_check_corrupt_chunk_delta()
+
+	return {
+		"storage": p_storage,
+		"voxels": full_decoded_voxels + edit_decoded_voxels,
+		"full_delta_bytes": full_delta.size(),
+		"edit_delta_bytes": edit_delta.size(),
+		"edits": edits,
+		"bytes_per_edit": edit_delta.size() / float(max(edits, 1)),
+		"decode_voxels_per_second": (full_decoded_voxels + edit_decoded_voxels) / max((full_decode_usec + edit_decode_usec) / 1000000.0, 0.000001),
+		"hashes_match": hashes_match,
+	}
+
+# Corrupts the opcode of the last chunk of an (uncompressed) delta, after a valid chunk,
+# and checks that applying it is rejected without touching the receiving storage at all.
+func _check_corrupt_chunk_delta() -> void:
+	var source := _make_occupancy_storage()
+	source.set_voxel_attribute_component_u8_unchecked(0, 1, 1, 1, 0, 255)
+	# Setting and clearing a voxel in the last chunk of the grid makes the delta end with that chunk being freed,
+	# so its opcode is the last byte of the payload.
+	var last := STORAGE_SIZE - 1
+	source.set_voxel_attribute_component_u8_unchecked(0, last, last, last, 0, 255)
+	source.set_voxel_attribute_component_u8_unchecked(0, last, last, last, 0, 0)
+
+	var delta := source.encode_delta(0)
+	var header_size := 10
+	if delta[5] == 1:
+		var payload := delta.slice(header_size).decompress(delta.decode_u32(6), FileAccess.COMPRESSION_FASTLZ)
+		delta = delta.slice(0, header_size) + payload
+		delta[5] = 0
+	delta[delta.size() - 1] = 0xFF
+
+	var replica := _make_occupancy_storage()
+	var hash_before := replica.get_voxel_data_hash()
+	var version_before := replica.get_version()
+	# Expected to print an error.
+	_check(replica.apply_delta(delta) == ERR_FILE_CORRUPT, "delta_round_trip: a delta with a corrupt chunk opcode wasn't rejected")
+	_check(replica.get_voxel_data_hash() == hash_before and replica.get_version() == version_before and replica.get_occupied_voxel_count() == 0,
+			"delta_round_trip: a delta with a corrupt chunk opcode modified the replica")
+
+# Peak resident set size of the process, falling back to Godot's own peak static memory usage
+# on platforms without "/proc".
+func _get_peak_rss() -> int:
+	var status := FileAccess.open("/proc/self/status", FileAccess.READ)
+	if status:
+		while not status.eof_reached():
+			var line := status.get_line()
+			if line.begins_with("VmHWM:"):
+				return line.trim_prefix("VmHWM:").strip_edges().trim_suffix("kB").strip_edges().to_int() * 1024
+	return OS.get_static_memory_peak_usage()
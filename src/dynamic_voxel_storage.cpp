@@ -1,8 +1,18 @@
 #include "dynamic_voxel_storage.hpp"
 
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
+#include <godot_cpp/templates/sort_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
 
 #include "util.hpp"
+#include "simd.hpp"
+
+#include <limits>
+#include <type_traits>
 
 using namespace godot;
 
@@ -31,37 +41,1144 @@ size_t DynamicVoxelStorage::get_depth() const {
 	return depth;
 }
 
+size_t DynamicVoxelStorage::get_allocated_chunk_count() const {
+	return _allocated_chunk_info.size();
+}
+
+size_t DynamicVoxelStorage::get_reusable_chunk_count() const {
+	return _reusable_chunk_queue.size();
+}
+
+uint64_t DynamicVoxelStorage::get_occupied_voxel_count() const {
+	// Reusable chunks are empty, so their counters are 0.
+	uint64_t count = 0;
+	for (const AllocatedChunkInfo &chunk_info : _allocated_chunk_info) {
+		count += chunk_info.voxel_counter;
+	}
+	return count;
+}
+
+Dictionary DynamicVoxelStorage::get_statistics() const {
+	Dictionary result;
+
+	uint64_t chunk_byte_size = 0;
+	PackedInt64Array attribute_bytes;
+	for (size_t i = 0; i < _attribute_buffers.size(); i++) {
+		chunk_byte_size += _get_chunk_attribute_size(i);
+		attribute_bytes.append(_attribute_buffers[i].size());
+	}
+
+	result["allocated_chunks"] = (uint64_t)_allocated_chunk_info.size();
+	result["used_chunks"] = (uint64_t)(_allocated_chunk_info.size() - _reusable_chunk_queue.size());
+	result["reusable_chunks"] = (uint64_t)_reusable_chunk_queue.size();
+	// In the same order as the descriptors of the Attribute Object.
+	result["attribute_bytes"] = attribute_bytes;
+	// Memory that is allocated within the attribute buffers but only waiting to be reused.
+	result["reusable_bytes"] = (uint64_t)(_reusable_chunk_queue.size() * chunk_byte_size);
+	result["index_bytes"] = (uint64_t)(_chunk_buffer.size() * sizeof(uint32_t) + 
+			_chunk_versions.size() * sizeof(uint64_t) + 
+			_allocated_chunk_info.size() * sizeof(AllocatedChunkInfo) + 
+			_reusable_chunk_queue.size() * sizeof(uint32_t));
+
+	result["voxel_writes"] = VoxelStorageCounters::get(_counters.voxel_writes);
+	result["chunk_allocations"] = VoxelStorageCounters::get(_counters.chunk_allocations);
+	result["chunk_reuses"] = VoxelStorageCounters::get(_counters.chunk_reuses);
+	result["chunk_frees"] = VoxelStorageCounters::get(_counters.chunk_frees);
+#ifdef VODOT_PROFILING
+	result["allocation_time_usec"] = VoxelStorageCounters::get(_counters.allocation_time_nsec) / 1000;
+	result["bulk_time_usec"] = VoxelStorageCounters::get(_counters.bulk_time_nsec) / 1000;
+#endif
+	return result;
+}
+
+void DynamicVoxelStorage::reset_statistics_counters() {
+	VoxelStorageCounters::set(_counters.voxel_writes, 0);
+	VoxelStorageCounters::set(_counters.chunk_allocations, 0);
+	VoxelStorageCounters::set(_counters.chunk_reuses, 0);
+	VoxelStorageCounters::set(_counters.chunk_frees, 0);
+	VoxelStorageCounters::set(_counters.allocation_time_nsec, 0);
+	VoxelStorageCounters::set(_counters.bulk_time_nsec, 0);
+}
+
 // TODO: Add a new method that keeps the original Voxel data
 void DynamicVoxelStorage::resize_and_clear(size_t p_width, size_t p_height, size_t p_depth, size_t p_chunk_size) {
+	ERR_FAIL_COND_MSG(p_chunk_size == 0, "Chunk size must be greater than zero.");
+	VODOT_SCOPED_TIMER(_counters.bulk_time_nsec);
+	const size_t previous_chunk_size = chunk_size;
 	chunk_size = p_chunk_size;
 
-	width = p_width + (chunk_size - (p_width % chunk_size));
-	height = p_height + (chunk_size - (p_height % chunk_size));
-	depth = p_depth + (chunk_size - (p_depth % chunk_size));
+	// Aligned up to the chunk size, with at least one chunk along every axis.
+	width = MAX((p_width + chunk_size - 1) / chunk_size, (size_t)1) * chunk_size;
+	height = MAX((p_height + chunk_size - 1) / chunk_size, (size_t)1) * chunk_size;
+	depth = MAX((p_depth + chunk_size - 1) / chunk_size, (size_t)1) * chunk_size;
 
 	size_t chunk_buffer_size = (width / chunk_size) * (height / chunk_size) * (depth / chunk_size);
 
-	_chunk_buffer.reset();
-	// Ensures this TightLocalVector only allocates *absolutely* what is necessary.
-	// Contrary to what you might think, this won't happen if you don't reserve first.
-	_chunk_buffer.reserve(chunk_buffer_size);
-	_chunk_buffer.resize(chunk_buffer_size);
-	for (uint32_t &chunk_index : _chunk_buffer) {
-		chunk_index = EMPTY_CHUNK;
+	// When the grid keeps its layout (e.g. clear()), _init_buffers() marks the cleared chunks as modified,
+	// so that a delta will free them on the other end as well.
+	// Otherwise the chunk versions start over, and deltas can't be applied across the resize
+	// (the other end has to be resized the same way and then resynced from version 0).
+	if (chunk_size != previous_chunk_size || _chunk_buffer.size() != chunk_buffer_size) {
+		_chunk_versions.reset();
+		_chunk_versions.reserve(chunk_buffer_size);
+		_chunk_versions.resize(chunk_buffer_size);
+		for (uint64_t &chunk_version : _chunk_versions) {
+			chunk_version = 0;
+		}
+
+		_chunk_buffer.reset();
+		// Ensures this TightLocalVector only allocates *absolutely* what is necessary.
+		// Contrary to what you might think, this won't happen if you don't reserve first.
+		_chunk_buffer.reserve(chunk_buffer_size);
+		_chunk_buffer.resize(chunk_buffer_size);
+		for (uint32_t &chunk_index : _chunk_buffer) {
+			chunk_index = EMPTY_CHUNK;
+		}
 	}
+	_has_edit_region = false;
 
 	_init_buffers();
 }
 
+uint32_t DynamicVoxelStorage::_count_occupied_voxels(uint32_t p_chunk_index) const {
+	const size_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+
+	// OR every attribute of a voxel together, so each voxel only needs to be checked once per attribute.
+	LocalVector<uint8_t> occupied;
+	occupied.resize(chunk_voxel_count);
+	memset(occupied.ptr(), 0, chunk_voxel_count);
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		const size_t voxel_stride = _attribute_voxel_strides[attribute_index];
+		const uint8_t *chunk_ptr = _attribute_buffers[attribute_index].ptr() + (p_chunk_index * chunk_voxel_count * voxel_stride);
+		for (size_t voxel_index = 0; voxel_index < chunk_voxel_count; voxel_index++) {
+			const uint8_t *voxel_ptr = chunk_ptr + (voxel_index * voxel_stride);
+			for (size_t i = 0; i < voxel_stride; i++) {
+				occupied[voxel_index] |= voxel_ptr[i];
+			}
+		}
+	}
+
+	uint32_t count = 0;
+	for (size_t voxel_index = 0; voxel_index < chunk_voxel_count; voxel_index++) {
+		count += occupied[voxel_index] != 0;
+	}
+	return count;
+}
+
 void DynamicVoxelStorage::_init_buffers() {
+	// Every chunk is dropped along with the buffers, so none of the grid cells may point into them anymore.
+	for (size_t chunk_buffer_index = 0; chunk_buffer_index < _chunk_buffer.size(); chunk_buffer_index++) {
+		if (_chunk_buffer[chunk_buffer_index] == EMPTY_CHUNK) continue;
+
+		_chunk_buffer[chunk_buffer_index] = EMPTY_CHUNK;
+		_mark_chunk_modified(chunk_buffer_index);
+	}
+
 	_attribute_buffers.reset();
-	if (get_voxel_attribute_object().is_valid()) {
-		_attribute_buffers.resize(get_voxel_attribute_object()->get_descriptors().size());
+	_attribute_voxel_strides.reset();
+	_allocated_chunk_info.reset();
+	_reusable_chunk_queue.reset();
+	// Nothing of what was applied is left, so the next delta has to start from scratch.
+	_applied_delta_version = 0;
+	if (voxel_attribute_object.is_valid()) {
+		const LocalVector<Ref<VoxelAttributeDescriptor>> &descriptors = voxel_attribute_object->descriptors;
+		_attribute_buffers.resize(descriptors.size());
+		_attribute_voxel_strides.resize(descriptors.size());
+		for (size_t i = 0; i < _attribute_voxel_strides.size(); i++) {
+			const Ref<VoxelAttributeDescriptor> &attribute_info = descriptors[i];
+			_attribute_voxel_strides[i] = attribute_info->get_component_size() * attribute_info->get_num_components();
+		}
+	}
+
+	uint64_t chunk_byte_size = 0;
+	for (size_t i = 0; i < _attribute_buffers.size(); i++) {
+		chunk_byte_size += _get_chunk_attribute_size(i);
+	}
+	VoxelStorageCounters::set(_counters.chunk_byte_size, chunk_byte_size);
+	VoxelStorageCounters::set(_counters.allocated_chunks, 0);
+	VoxelStorageCounters::set(_counters.reusable_chunks, 0);
+}
+
+int64_t DynamicVoxelStorage::apply_brush(const Ref<VoxelBrush> &p_brush, size_t p_attribute_index, size_t p_component_index) {
+	ERR_FAIL_COND_V_MSG(p_brush.is_null(), 0, "Cannot apply a null Voxel Brush.");
+	ERR_FAIL_INDEX_V_MSG(p_attribute_index, _attribute_buffers.size(), 0, "Attribute index out of range.");
+	const Ref<VoxelAttributeDescriptor> &attribute_info = get_voxel_attribute_object()->descriptors[p_attribute_index];
+	ERR_FAIL_INDEX_V_MSG(p_component_index, attribute_info->get_num_components(), 0, "Component index out of range.");
+	VODOT_SCOPED_TIMER(_counters.bulk_time_nsec);
+
+	const VoxelBrush::Operation operation = p_brush->get_operation();
+	const bool is_intersect = operation == VoxelBrush::OPERATION_INTERSECT;
+	// Subtract and Intersect can only ever lower values, so empty chunks stay empty.
+	const bool can_allocate = operation == VoxelBrush::OPERATION_UNION || operation == VoxelBrush::OPERATION_SMOOTH_BLEND;
+
+	const int32_t chunk_length = chunk_size;
+	const Vector3i size = Vector3i(width, height, depth);
+	const Vector3i grid_size = size / chunk_length;
+
+	// The range of voxels the brush can affect, clamped to the storage.
+	const AABB bounds = p_brush->get_bounds();
+	Vector3i brush_from;
+	Vector3i brush_to;
+	for (int axis = 0; axis < 3; axis++) {
+		brush_from[axis] = CLAMP((int64_t)Math::floor(bounds.position[axis]), (int64_t)0, (int64_t)size[axis]);
+		brush_to[axis] = CLAMP((int64_t)Math::ceil(bounds.position[axis] + bounds.size[axis]) + 1, (int64_t)0, (int64_t)size[axis]);
+	}
+	const bool brush_is_empty = brush_from.x >= brush_to.x || brush_from.y >= brush_to.y || brush_from.z >= brush_to.z;
+	if (brush_is_empty && !is_intersect) return 0;
+
+	// Intersect clears everything outside of the brush, so it has to visit every chunk.
+	Vector3i chunk_from = is_intersect ? Vector3i() : brush_from / chunk_length;
+	Vector3i chunk_to = is_intersect ? grid_size : (brush_to + Vector3i(chunk_length - 1, chunk_length - 1, chunk_length - 1)) / chunk_length;
+
+	// If the distance to the center of a chunk is further than this from the surface, the whole chunk is either inside or outside.
+	const float chunk_radius = (chunk_size - 1) * 0.5f * Math::sqrt(3.0f);
+	const float classify_distance = chunk_radius + p_brush->get_margin();
+
+	BrushState state;
+	state.storage = this;
+	state.brush = p_brush.ptr();
+	state.type = attribute_info->get_type();
+	state.voxel_stride = _attribute_voxel_strides[p_attribute_index];
+	state.component_offset = p_component_index * attribute_info->get_component_size();
+	state.attribute_index = p_attribute_index;
+
+	for (int32_t cz = chunk_from.z; cz < chunk_to.z; cz++) {
+		for (int32_t cy = chunk_from.y; cy < chunk_to.y; cy++) {
+			for (int32_t cx = chunk_from.x; cx < chunk_to.x; cx++) {
+				BrushChunkJob job;
+				job.grid_index = util::index_3d(cx, cy, cz, grid_size.x, grid_size.y, grid_size.z);
+				uint32_t &chunk_index = _chunk_buffer[job.grid_index];
+				if (chunk_index == EMPTY_CHUNK && !can_allocate) continue;
+
+				job.chunk_origin = Vector3i(cx, cy, cz) * chunk_length;
+				job.from = job.chunk_origin;
+				job.to = job.chunk_origin + Vector3i(chunk_length, chunk_length, chunk_length);
+
+				bool overlaps_brush = !brush_is_empty;
+				for (int axis = 0; axis < 3; axis++) {
+					overlaps_brush = overlaps_brush && job.from[axis] < brush_to[axis] && job.to[axis] > brush_from[axis];
+				}
+				const Vector3 chunk_center = Vector3(job.chunk_origin) + Vector3(1, 1, 1) * ((chunk_size - 1) * 0.5f);
+				const float distance = overlaps_brush ? p_brush->get_distance(chunk_center) : Math_INF;
+
+				if (distance > classify_distance) {
+					// Entirely outside, only Intersect has an effect here (clearing the chunk).
+					if (!is_intersect) continue;
+					job.constant_coverage = 0.0f;
+				} else if (distance < -classify_distance) {
+					// Entirely inside, Intersect leaves these alone.
+					if (is_intersect) continue;
+					job.constant_coverage = 1.0f;
+				} else if (!is_intersect) {
+					// Only evaluate the part of the chunk the brush can affect.
+					for (int axis = 0; axis < 3; axis++) {
+						job.from[axis] = MAX(job.from[axis], brush_from[axis]);
+						job.to[axis] = MIN(job.to[axis], brush_to[axis]);
+					}
+				}
+
+				if (chunk_index == EMPTY_CHUNK) {
+					chunk_index = _get_next_chunk();
+					if (chunk_index == EMPTY_CHUNK) return 0;
+				}
+				job.chunk_index = chunk_index;
+				state.jobs.push_back(job);
+			}
+		}
+	}
+
+	if (state.jobs.size() > 1) {
+		WorkerThreadPool *thread_pool = WorkerThreadPool::get_singleton();
+		int64_t group_id = thread_pool->add_native_group_task(&DynamicVoxelStorage::_apply_brush_chunk_task, &state, state.jobs.size(), -1, true, "Vodot: Apply Voxel Brush");
+		thread_pool->wait_for_group_task_completion(group_id);
+	} else if (state.jobs.size() == 1) {
+		_apply_brush_chunk(state, 0);
+	}
+
+	// Freeing has to happen on this thread, as it touches the reusable chunk queue.
+	int64_t voxels_written = 0;
+	for (const BrushChunkJob &job : state.jobs) {
+		Vector3i job_size = job.to - job.from;
+		voxels_written += (int64_t)job_size.x * job_size.y * job_size.z;
+		_expand_edit_region(job.from, job.to);
+		_mark_chunk_modified(job.grid_index);
+		if (_allocated_chunk_info[job.chunk_index].voxel_counter == 0) {
+			_free_chunk(_chunk_buffer[job.grid_index]);
+		}
+	}
+	VoxelStorageCounters::add(_counters.voxel_writes, voxels_written);
+	return voxels_written;
+}
+
+AABB DynamicVoxelStorage::get_edit_region() const {
+	if (!_has_edit_region) return AABB();
+	return AABB(Vector3(_edit_region_from), Vector3(_edit_region_to - _edit_region_from));
+}
+
+void DynamicVoxelStorage::clear_edit_region() {
+	_has_edit_region = false;
+}
+
+void DynamicVoxelStorage::_copy_voxel(const DynamicVoxelStorage &p_source, uint32_t p_source_chunk_index, size_t p_source_chunk_voxel_index, size_t p_x, size_t p_y, size_t p_z) {
+	size_t chunk_buffer_index = _get_chunk_buffer_index(p_x, p_y, p_z);
+	uint32_t &chunk_index = _chunk_buffer[chunk_buffer_index];
+	if (chunk_index == EMPTY_CHUNK) {
+		chunk_index = _get_next_chunk();
+		ERR_FAIL_COND(chunk_index == EMPTY_CHUNK);
+	}
+	_mark_chunk_modified(chunk_buffer_index);
+
+	size_t chunk_voxel_index = util::index_3d(
+			p_x % chunk_size, p_y % chunk_size, p_z % chunk_size,
+			chunk_size, chunk_size, chunk_size);
+	const size_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+	const size_t source_chunk_voxel_count = p_source.chunk_size * p_source.chunk_size * p_source.chunk_size;
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		const size_t voxel_stride = _attribute_voxel_strides[attribute_index];
+		memcpy(
+				&_attribute_buffers[attribute_index][((chunk_index * chunk_voxel_count) + chunk_voxel_index) * voxel_stride],
+				&p_source._attribute_buffers[attribute_index][((p_source_chunk_index * source_chunk_voxel_count) + p_source_chunk_voxel_index) * voxel_stride],
+				voxel_stride);
+	}
+	_allocated_chunk_info[chunk_index].voxel_counter++;
+	_expand_edit_region(Vector3i(p_x, p_y, p_z), Vector3i(p_x + 1, p_y + 1, p_z + 1));
+	VoxelStorageCounters::add(_counters.voxel_writes);
+}
+
+Array DynamicVoxelStorage::find_connected_components(size_t p_attribute_index, const Vector3i &p_from, const Vector3i &p_to, bool p_extract) {
+	ERR_FAIL_INDEX_V_MSG(p_attribute_index, _attribute_buffers.size(), Array(), "Attribute index out of range.");
+	VODOT_SCOPED_TIMER(_counters.bulk_time_nsec);
+
+	const int32_t chunk_length = chunk_size;
+	const Vector3i size = Vector3i(width, height, depth);
+	const Vector3i grid_size = size / chunk_length;
+
+	ComponentState state;
+	state.storage = this;
+	state.attribute_index = p_attribute_index;
+	state.voxel_stride = _attribute_voxel_strides[p_attribute_index];
+	for (int axis = 0; axis < 3; axis++) {
+		state.region_from[axis] = CLAMP(p_from[axis], 0, size[axis]);
+		state.region_to[axis] = CLAMP(p_to[axis], 0, size[axis]);
+		if (state.region_from[axis] >= state.region_to[axis]) return Array();
+	}
+
+	// Maps the chunks overlapping the region to their job (or -1 for empty chunks), so neighbours can be found when merging.
+	const Vector3i chunk_from = state.region_from / chunk_length;
+	const Vector3i chunk_to = (state.region_to + Vector3i(chunk_length - 1, chunk_length - 1, chunk_length - 1)) / chunk_length;
+	const Vector3i chunk_range = chunk_to - chunk_from;
+	LocalVector<int32_t> job_lookup;
+	job_lookup.resize(chunk_range.x * chunk_range.y * chunk_range.z);
+
+	for (int32_t cz = chunk_from.z; cz < chunk_to.z; cz++) {
+		for (int32_t cy = chunk_from.y; cy < chunk_to.y; cy++) {
+			for (int32_t cx = chunk_from.x; cx < chunk_to.x; cx++) {
+				int32_t &job_index = job_lookup[util::index_3d(
+						cx - chunk_from.x, cy - chunk_from.y, cz - chunk_from.z,
+						chunk_range.x, chunk_range.y, chunk_range.z)];
+				job_index = -1;
+
+				uint32_t chunk_index = _chunk_buffer[util::index_3d(cx, cy, cz, grid_size.x, grid_size.y, grid_size.z)];
+				if (chunk_index == EMPTY_CHUNK) continue;
+
+				ComponentChunkJob job;
+				job.chunk_index = chunk_index;
+				job.chunk_origin = Vector3i(cx, cy, cz) * chunk_length;
+				for (int axis = 0; axis < 3; axis++) {
+					job.from[axis] = MAX(job.chunk_origin[axis], state.region_from[axis]);
+					job.to[axis] = MIN(job.chunk_origin[axis] + chunk_length, state.region_to[axis]);
+				}
+				job_index = state.jobs.size();
+				state.jobs.push_back(job);
+			}
+		}
+	}
+
+	if (state.jobs.size() > 1) {
+		WorkerThreadPool *thread_pool = WorkerThreadPool::get_singleton();
+		int64_t group_id = thread_pool->add_native_group_task(&DynamicVoxelStorage::_label_component_chunk_task, &state, state.jobs.size(), -1, true, "Vodot: Label Connected Components");
+		thread_pool->wait_for_group_task_completion(group_id);
+	} else if (state.jobs.size() == 1) {
+		_label_component_chunk(state, 0);
+	}
+
+	uint32_t label_count = 0;
+	for (ComponentChunkJob &job : state.jobs) {
+		job.label_offset = label_count;
+		label_count += job.components.size();
+	}
+
+	// Merge the local components of neighbouring chunks wherever they touch.
+	util::UnionFind union_find;
+	union_find.reset(label_count);
+	for (int32_t cz = chunk_from.z; cz < chunk_to.z; cz++) {
+		for (int32_t cy = chunk_from.y; cy < chunk_to.y; cy++) {
+			for (int32_t cx = chunk_from.x; cx < chunk_to.x; cx++) {
+				const Vector3i chunk = Vector3i(cx, cy, cz);
+				int32_t job_index = job_lookup[util::index_3d(
+						cx - chunk_from.x, cy - chunk_from.y, cz - chunk_from.z,
+						chunk_range.x, chunk_range.y, chunk_range.z)];
+				if (job_index < 0) continue;
+				const ComponentChunkJob &job = state.jobs[job_index];
+
+				for (int axis = 0; axis < 3; axis++) {
+					Vector3i neighbour_chunk = chunk;
+					neighbour_chunk[axis]++;
+					if (neighbour_chunk[axis] >= chunk_to[axis]) continue;
+					int32_t neighbour_job_index = job_lookup[util::index_3d(
+							neighbour_chunk.x - chunk_from.x, neighbour_chunk.y - chunk_from.y, neighbour_chunk.z - chunk_from.z,
+							chunk_range.x, chunk_range.y, chunk_range.z)];
+					if (neighbour_job_index < 0) continue;
+					const ComponentChunkJob &neighbour_job = state.jobs[neighbour_job_index];
+
+					// Walk the face shared by both chunks. The other two axes span the same range in both jobs.
+					const int axis_u = (axis + 1) % 3;
+					const int axis_v = (axis + 2) % 3;
+					Vector3i position;
+					for (position[axis_v] = job.from[axis_v]; position[axis_v] < job.to[axis_v]; position[axis_v]++) {
+						for (position[axis_u] = job.from[axis_u]; position[axis_u] < job.to[axis_u]; position[axis_u]++) {
+							position[axis] = job.to[axis] - 1;
+							uint32_t label = job.get_label(position.x, position.y, position.z);
+							if (label == 0) continue;
+							position[axis] = neighbour_job.from[axis];
+							uint32_t neighbour_label = neighbour_job.get_label(position.x, position.y, position.z);
+							if (neighbour_label == 0) continue;
+							union_find.unite(job.label_offset + label - 1, neighbour_job.label_offset + neighbour_label - 1);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Gather the local components into their merged components.
+	LocalVector<ComponentInfo> components;
+	LocalVector<uint32_t> component_of_root;
+	component_of_root.resize(label_count);
+	for (const ComponentChunkJob &job : state.jobs) {
+		for (uint32_t local_label = 0; local_label < job.components.size(); local_label++) {
+			const uint32_t label = job.label_offset + local_label;
+			const uint32_t root = union_find.find(label);
+			const ComponentInfo &local_component = job.components[local_label];
+			// Roots are the smallest label of their set, so they are always visited first.
+			if (root == label) {
+				component_of_root[root] = components.size();
+				components.push_back(local_component);
+				continue;
+			}
+			ComponentInfo &component = components[component_of_root[root]];
+			component.voxel_count += local_component.voxel_count;
+			component.touches_region_border = component.touches_region_border || local_component.touches_region_border;
+			for (int axis = 0; axis < 3; axis++) {
+				component.from[axis] = MIN(component.from[axis], local_component.from[axis]);
+				component.to[axis] = MAX(component.to[axis], local_component.to[axis]);
+			}
+		}
+	}
+
+	LocalVector<Ref<DynamicVoxelStorage>> extracted_storages;
+	if (p_extract) {
+		extracted_storages.resize(components.size());
+		for (uint32_t i = 0; i < components.size(); i++) {
+			const Vector3i component_size = components[i].to - components[i].from;
+			Ref<DynamicVoxelStorage> storage;
+			storage.instantiate();
+			storage->set_voxel_attribute_object(get_voxel_attribute_object());
+			storage->resize_and_clear(component_size.x, component_size.y, component_size.z, chunk_size);
+			extracted_storages[i] = storage;
+		}
+
+		for (const ComponentChunkJob &job : state.jobs) {
+			for (int32_t z = job.from.z; z < job.to.z; z++) {
+				for (int32_t y = job.from.y; y < job.to.y; y++) {
+					for (int32_t x = job.from.x; x < job.to.x; x++) {
+						uint32_t label = job.get_label(x, y, z);
+						if (label == 0) continue;
+						uint32_t component_index = component_of_root[union_find.find(job.label_offset + label - 1)];
+						const Vector3i &component_from = components[component_index].from;
+						size_t chunk_voxel_index = util::index_3d(
+								x - job.chunk_origin.x, y - job.chunk_origin.y, z - job.chunk_origin.z,
+								chunk_size, chunk_size, chunk_size);
+						extracted_storages[component_index]->_copy_voxel(*this, job.chunk_index, chunk_voxel_index,
+								x - component_from.x, y - component_from.y, z - component_from.z);
+					}
+				}
+			}
+		}
+	}
+
+	// Largest first, usually the one still attached to everything else.
+	LocalVector<uint32_t> order;
+	order.resize(components.size());
+	for (uint32_t i = 0; i < components.size(); i++) {
+		order[i] = i;
+	}
+	struct LargerComponent {
+		const LocalVector<ComponentInfo> *components = nullptr;
+		_ALWAYS_INLINE_ bool operator()(uint32_t p_a, uint32_t p_b) const {
+			return (*components)[p_a].voxel_count > (*components)[p_b].voxel_count;
+		}
+	};
+	SortArray<uint32_t, LargerComponent> sorter;
+	sorter.compare.components = &components;
+	sorter.sort(order.ptr(), order.size());
+
+	Array result;
+	for (uint32_t component_index : order) {
+		const ComponentInfo &component = components[component_index];
+		Dictionary dictionary;
+		dictionary["voxel_count"] = component.voxel_count;
+		dictionary["bounds"] = AABB(Vector3(component.from), Vector3(component.to - component.from));
+		dictionary["touches_region_border"] = component.touches_region_border;
+		if (p_extract) {
+			dictionary["storage"] = extracted_storages[component_index];
+		}
+		result.append(dictionary);
+	}
+	return result;
+}
+
+Array DynamicVoxelStorage::find_connected_components_in_edit_region(size_t p_attribute_index, int32_t p_margin, bool p_extract) {
+	// Checked up front, so that a failed call doesn't throw away the edit region.
+	ERR_FAIL_INDEX_V_MSG(p_attribute_index, _attribute_buffers.size(), Array(), "Attribute index out of range.");
+	if (!_has_edit_region) return Array();
+	Vector3i from = _edit_region_from - Vector3i(p_margin, p_margin, p_margin);
+	Vector3i to = _edit_region_to + Vector3i(p_margin, p_margin, p_margin);
+	Array components = find_connected_components(p_attribute_index, from, to, p_extract);
+	clear_edit_region();
+	return components;
+}
+
+// The delta stream format. Everything after the header is compressed as a whole.
+//
+// Header:  "VDLT", format version (u8), compression (u8), uncompressed payload size (u32).
+// Payload: since version (u64), version (u64), width, height, depth and chunk size (u32),
+//          attribute count (u32) and the voxel stride of every attribute (u32), chunk count (u32),
+//          then per chunk its chunk buffer index (u32), a chunk opcode (u8) and its data.
+//
+// Values are written in the host byte order, which is little endian on every platform this is built for.
+static const uint8_t DELTA_MAGIC[4] = { 'V', 'D', 'L', 'T' };
+static const uint8_t DELTA_FORMAT_VERSION = 1;
+static const size_t DELTA_HEADER_SIZE = 10;
+
+enum DeltaCompression : uint8_t {
+	DELTA_COMPRESSION_NONE,
+	DELTA_COMPRESSION_FASTLZ
+};
+
+enum DeltaChunkOpcode : uint8_t {
+	DELTA_CHUNK_FREED, // No data.
+	DELTA_CHUNK_UNIFORM, // Every voxel is the same, followed by that voxel for every attribute.
+	DELTA_CHUNK_ATTRIBUTES // Followed by an attribute opcode and its data for every attribute.
+};
+
+enum DeltaAttributeOpcode : uint8_t {
+	DELTA_ATTRIBUTE_UNIFORM, // A single voxel.
+	DELTA_ATTRIBUTE_RLE, // Runs of (length as a varint, voxel) covering the whole chunk.
+	DELTA_ATTRIBUTE_RAW // Every voxel.
+};
+
+template <typename T>
+static void _write_delta_value(LocalVector<uint8_t> &r_stream, T p_value) {
+	size_t position = r_stream.size();
+	r_stream.resize(position + sizeof(T));
+	memcpy(&r_stream[position], &p_value, sizeof(T));
+}
+
+static void _write_delta_bytes(LocalVector<uint8_t> &r_stream, const uint8_t *p_bytes, size_t p_size) {
+	size_t position = r_stream.size();
+	r_stream.resize(position + p_size);
+	memcpy(&r_stream[position], p_bytes, p_size);
+}
+
+static void _write_delta_varint(LocalVector<uint8_t> &r_stream, uint64_t p_value) {
+	while (p_value >= 0x80) {
+		_write_delta_value<uint8_t>(r_stream, (p_value & 0x7F) | 0x80);
+		p_value >>= 7;
+	}
+	_write_delta_value<uint8_t>(r_stream, p_value);
+}
+
+static size_t _get_delta_varint_size(uint64_t p_value) {
+	size_t size = 1;
+	while (p_value >= 0x80) {
+		p_value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+// Reads are bounds checked, and return false once the stream runs out.
+template <typename T>
+static bool _read_delta_value(const uint8_t *p_stream, size_t p_stream_size, size_t &r_position, T &r_value) {
+	if (p_stream_size - r_position < sizeof(T)) return false;
+	memcpy(&r_value, p_stream + r_position, sizeof(T));
+	r_position += sizeof(T);
+	return true;
+}
+
+static const uint8_t *_read_delta_bytes(const uint8_t *p_stream, size_t p_stream_size, size_t &r_position, size_t p_size) {
+	if (p_stream_size - r_position < p_size) return nullptr;
+	const uint8_t *bytes = p_stream + r_position;
+	r_position += p_size;
+	return bytes;
+}
+
+static bool _read_delta_varint(const uint8_t *p_stream, size_t p_stream_size, size_t &r_position, uint64_t &r_value) {
+	r_value = 0;
+	for (uint32_t shift = 0; shift < 64; shift += 7) {
+		uint8_t byte = 0;
+		if (!_read_delta_value(p_stream, p_stream_size, r_position, byte)) return false;
+		r_value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+// Fills "p_count" voxels with the same value.
+static void _fill_voxels(uint8_t *r_voxels, const uint8_t *p_value, size_t p_count, size_t p_voxel_stride) {
+	if (p_voxel_stride == 1) {
+		memset(r_voxels, *p_value, p_count);
+		return;
+	}
+	for (size_t i = 0; i < p_count; i++) {
+		memcpy(r_voxels + (i * p_voxel_stride), p_value, p_voxel_stride);
+	}
+}
+
+void DynamicVoxelStorage::_encode_chunk_delta(LocalVector<uint8_t> &r_stream, uint32_t p_chunk_index) const {
+	const size_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+
+	// Measure the runs of every attribute first, to pick the smallest encoding.
+	LocalVector<size_t> run_counts;
+	LocalVector<size_t> rle_sizes;
+	run_counts.resize(_attribute_buffers.size());
+	rle_sizes.resize(_attribute_buffers.size());
+	bool is_uniform = true;
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		const size_t chunk_attribute_size = _get_chunk_attribute_size(attribute_index);
+		const size_t voxel_stride = chunk_attribute_size / chunk_voxel_count;
+		const uint8_t *chunk_ptr = _attribute_buffers[attribute_index].ptr() + (p_chunk_index * chunk_attribute_size);
+
+		size_t run_count = 1;
+		size_t run_length = 1;
+		size_t rle_size = 0;
+		for (size_t voxel_index = 1; voxel_index < chunk_voxel_count; voxel_index++) {
+			const uint8_t *voxel_ptr = chunk_ptr + (voxel_index * voxel_stride);
+			if (memcmp(voxel_ptr, voxel_ptr - voxel_stride, voxel_stride) == 0) {
+				run_length++;
+				continue;
+			}
+			rle_size += _get_delta_varint_size(run_length) + voxel_stride;
+			run_count++;
+			run_length = 1;
+		}
+		rle_size += _get_delta_varint_size(run_length) + voxel_stride;
+
+		run_counts[attribute_index] = run_count;
+		rle_sizes[attribute_index] = rle_size;
+		is_uniform = is_uniform && run_count == 1;
+	}
+
+	_write_delta_value<uint8_t>(r_stream, is_uniform ? DELTA_CHUNK_UNIFORM : DELTA_CHUNK_ATTRIBUTES);
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		const size_t chunk_attribute_size = _get_chunk_attribute_size(attribute_index);
+		const size_t voxel_stride = chunk_attribute_size / chunk_voxel_count;
+		const uint8_t *chunk_ptr = _attribute_buffers[attribute_index].ptr() + (p_chunk_index * chunk_attribute_size);
+
+		if (is_uniform) {
+			_write_delta_bytes(r_stream, chunk_ptr, voxel_stride);
+		} else if (run_counts[attribute_index] == 1) {
+			_write_delta_value<uint8_t>(r_stream, DELTA_ATTRIBUTE_UNIFORM);
+			_write_delta_bytes(r_stream, chunk_ptr, voxel_stride);
+		} else if (rle_sizes[attribute_index] < chunk_attribute_size) {
+			_write_delta_value<uint8_t>(r_stream, DELTA_ATTRIBUTE_RLE);
+			size_t run_start = 0;
+			for (size_t voxel_index = 1; voxel_index <= chunk_voxel_count; voxel_index++) {
+				if (voxel_index < chunk_voxel_count && 
+						memcmp(chunk_ptr + (voxel_index * voxel_stride), chunk_ptr + (run_start * voxel_stride), voxel_stride) == 0) {
+					continue;
+				}
+				_write_delta_varint(r_stream, voxel_index - run_start);
+				_write_delta_bytes(r_stream, chunk_ptr + (run_start * voxel_stride), voxel_stride);
+				run_start = voxel_index;
+			}
+		} else {
+			_write_delta_value<uint8_t>(r_stream, DELTA_ATTRIBUTE_RAW);
+			_write_delta_bytes(r_stream, chunk_ptr, chunk_attribute_size);
+		}
+	}
+}
+
+uint64_t DynamicVoxelStorage::_get_max_chunk_delta_size() const {
+	// Chunk buffer index and chunk opcode, then an attribute opcode and every voxel (RLE is only used when it's smaller) per attribute.
+	uint64_t size = sizeof(uint32_t) + sizeof(uint8_t);
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		size += sizeof(uint8_t) + _get_chunk_attribute_size(attribute_index);
+	}
+	return size;
+}
+
+bool DynamicVoxelStorage::_decode_chunk_delta(const uint8_t *p_stream, size_t p_stream_size, size_t &r_position, size_t p_chunk_buffer_index, bool p_apply) {
+	const size_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+
+	uint8_t chunk_opcode = 0;
+	if (!_read_delta_value(p_stream, p_stream_size, r_position, chunk_opcode)) return false;
+	if (chunk_opcode != DELTA_CHUNK_FREED && chunk_opcode != DELTA_CHUNK_UNIFORM && chunk_opcode != DELTA_CHUNK_ATTRIBUTES) return false;
+	// Without any attributes there is nowhere to put the data of a chunk.
+	if (chunk_opcode != DELTA_CHUNK_FREED && _attribute_buffers.is_empty()) return false;
+
+	uint32_t *chunk_index = nullptr;
+	if (p_apply) {
+		const size_t grid_width = width / chunk_size;
+		const size_t grid_height = height / chunk_size;
+		const Vector3i chunk_origin = Vector3i(
+				p_chunk_buffer_index % grid_width, 
+				(p_chunk_buffer_index / grid_width) % grid_height, 
+				p_chunk_buffer_index / (grid_width * grid_height)) * chunk_size;
+		_expand_edit_region(chunk_origin, chunk_origin + Vector3i(chunk_size, chunk_size, chunk_size));
+		_mark_chunk_modified(p_chunk_buffer_index);
+
+		chunk_index = &_chunk_buffer[p_chunk_buffer_index];
+	}
+
+	if (chunk_opcode == DELTA_CHUNK_FREED) {
+		if (p_apply && *chunk_index != EMPTY_CHUNK) {
+			// Reusable chunks are expected to be all zeroes.
+			for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+				const size_t chunk_attribute_size = _get_chunk_attribute_size(attribute_index);
+				memset(_attribute_buffers[attribute_index].ptr() + (*chunk_index * chunk_attribute_size), 0, chunk_attribute_size);
+			}
+			_allocated_chunk_info[*chunk_index].voxel_counter = 0;
+			_free_chunk(*chunk_index);
+		}
+		return true;
+	}
+
+	if (p_apply && *chunk_index == EMPTY_CHUNK) {
+		*chunk_index = _get_next_chunk();
+		if (*chunk_index == EMPTY_CHUNK) return false;
+	}
+
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		const size_t chunk_attribute_size = _get_chunk_attribute_size(attribute_index);
+		const size_t voxel_stride = _attribute_voxel_strides[attribute_index];
+		uint8_t *chunk_ptr = p_apply ? _attribute_buffers[attribute_index].ptr() + (*chunk_index * chunk_attribute_size) : nullptr;
+
+		uint8_t attribute_opcode = DELTA_ATTRIBUTE_UNIFORM;
+		if (chunk_opcode == DELTA_CHUNK_ATTRIBUTES && !_read_delta_value(p_stream, p_stream_size, r_position, attribute_opcode)) return false;
+		switch (attribute_opcode) {
+			case DELTA_ATTRIBUTE_UNIFORM: {
+				const uint8_t *value = _read_delta_bytes(p_stream, p_stream_size, r_position, voxel_stride);
+				if (!value) return false;
+				if (p_apply) _fill_voxels(chunk_ptr, value, chunk_voxel_count, voxel_stride);
+			} break;
+			case DELTA_ATTRIBUTE_RLE: {
+				size_t voxel_index = 0;
+				while (voxel_index < chunk_voxel_count) {
+					uint64_t run_length = 0;
+					if (!_read_delta_varint(p_stream, p_stream_size, r_position, run_length)) return false;
+					if (run_length == 0 || run_length > chunk_voxel_count - voxel_index) return false;
+					const uint8_t *value = _read_delta_bytes(p_stream, p_stream_size, r_position, voxel_stride);
+					if (!value) return false;
+					if (p_apply) _fill_voxels(chunk_ptr + (voxel_index * voxel_stride), value, run_length, voxel_stride);
+					voxel_index += run_length;
+				}
+			} break;
+			case DELTA_ATTRIBUTE_RAW: {
+				const uint8_t *voxels = _read_delta_bytes(p_stream, p_stream_size, r_position, chunk_attribute_size);
+				if (!voxels) return false;
+				if (p_apply) memcpy(chunk_ptr, voxels, chunk_attribute_size);
+			} break;
+			default:
+				return false;
+		}
+	}
+
+	if (p_apply) {
+		_allocated_chunk_info[*chunk_index].voxel_counter = _count_occupied_voxels(*chunk_index);
+		if (_allocated_chunk_info[*chunk_index].voxel_counter == 0) {
+			_free_chunk(*chunk_index);
+		}
+	}
+	return true;
+}
+
+uint64_t DynamicVoxelStorage::get_version() const {
+	return _version;
+}
+
+uint64_t DynamicVoxelStorage::get_applied_delta_version() const {
+	return _applied_delta_version;
+}
+
+PackedByteArray DynamicVoxelStorage::encode_delta(uint64_t p_since_version) const {
+	VODOT_SCOPED_TIMER(_counters.bulk_time_nsec);
+	LocalVector<uint8_t> payload;
+	_write_delta_value<uint64_t>(payload, p_since_version);
+	_write_delta_value<uint64_t>(payload, _version);
+	_write_delta_value<uint32_t>(payload, width);
+	_write_delta_value<uint32_t>(payload, height);
+	_write_delta_value<uint32_t>(payload, depth);
+	_write_delta_value<uint32_t>(payload, chunk_size);
+	_write_delta_value<uint32_t>(payload, _attribute_buffers.size());
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		_write_delta_value<uint32_t>(payload, _attribute_voxel_strides[attribute_index]);
+	}
+
+	// Patched once the chunks are written.
+	const size_t chunk_count_position = payload.size();
+	uint32_t chunk_count = 0;
+	_write_delta_value<uint32_t>(payload, chunk_count);
+	// The payload size has to fit the 32 bit field of the header (and the payload itself).
+	const uint64_t max_chunk_delta_size = _get_max_chunk_delta_size();
+	for (size_t chunk_buffer_index = 0; chunk_buffer_index < _chunk_buffer.size(); chunk_buffer_index++) {
+		if (_chunk_versions[chunk_buffer_index] <= p_since_version) continue;
+		ERR_FAIL_COND_V_MSG(payload.size() + max_chunk_delta_size > UINT32_MAX, PackedByteArray(), 
+				"Voxel delta would be larger than 4 GiB, encode the changes in smaller steps.");
+
+		_write_delta_value<uint32_t>(payload, chunk_buffer_index);
+		if (_chunk_buffer[chunk_buffer_index] == EMPTY_CHUNK) {
+			_write_delta_value<uint8_t>(payload, DELTA_CHUNK_FREED);
+		} else {
+			_encode_chunk_delta(payload, _chunk_buffer[chunk_buffer_index]);
+		}
+		chunk_count++;
+	}
+	memcpy(&payload[chunk_count_position], &chunk_count, sizeof(uint32_t));
+
+	PackedByteArray uncompressed;
+	uncompressed.resize(payload.size());
+	memcpy(uncompressed.ptrw(), payload.ptr(), payload.size());
+	PackedByteArray compressed = uncompressed.compress(FileAccess::COMPRESSION_FASTLZ);
+	const bool use_compression = !compressed.is_empty() && compressed.size() < uncompressed.size();
+	const PackedByteArray &body = use_compression ? compressed : uncompressed;
+
+	PackedByteArray result;
+	result.resize(DELTA_HEADER_SIZE + body.size());
+	uint8_t *result_ptr = result.ptrw();
+	const uint32_t payload_size = payload.size();
+	memcpy(result_ptr, DELTA_MAGIC, sizeof(DELTA_MAGIC));
+	result_ptr[4] = DELTA_FORMAT_VERSION;
+	result_ptr[5] = use_compression ? DELTA_COMPRESSION_FASTLZ : DELTA_COMPRESSION_NONE;
+	memcpy(result_ptr + 6, &payload_size, sizeof(uint32_t));
+	memcpy(result_ptr + DELTA_HEADER_SIZE, body.ptr(), body.size());
+	return result;
+}
+
+Error DynamicVoxelStorage::apply_delta(const PackedByteArray &p_delta) {
+	VODOT_SCOPED_TIMER(_counters.bulk_time_nsec);
+	const size_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+
+	ERR_FAIL_COND_V_MSG(p_delta.size() < (int64_t)DELTA_HEADER_SIZE, ERR_INVALID_DATA, "Voxel delta is too small.");
+	const uint8_t *header = p_delta.ptr();
+	ERR_FAIL_COND_V_MSG(memcmp(header, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0, ERR_INVALID_DATA, "Not a Voxel delta.");
+	ERR_FAIL_COND_V_MSG(header[4] != DELTA_FORMAT_VERSION, ERR_INVALID_DATA, "Unsupported Voxel delta format version.");
+	uint32_t payload_size = 0;
+	memcpy(&payload_size, header + 6, sizeof(uint32_t));
+
+	// The payload size comes from the (untrusted) header, so it has to be bounded before anything gets allocated for it.
+	// Every chunk of the grid stored with the largest encoding is as big as a valid payload can get.
+	const uint64_t max_payload_size = (sizeof(uint64_t) * 2) + (sizeof(uint32_t) * 6) + 
+			(_attribute_buffers.size() * sizeof(uint32_t)) + (_chunk_buffer.size() * _get_max_chunk_delta_size());
+	ERR_FAIL_COND_V_MSG(payload_size > max_payload_size, ERR_INVALID_DATA, "Voxel delta payload is larger than this storage could ever produce.");
+
+	PackedByteArray payload = p_delta.slice(DELTA_HEADER_SIZE);
+	if (header[5] == DELTA_COMPRESSION_FASTLZ) {
+		payload = payload.decompress(payload_size, FileAccess::COMPRESSION_FASTLZ);
+	} else {
+		ERR_FAIL_COND_V_MSG(header[5] != DELTA_COMPRESSION_NONE, ERR_INVALID_DATA, "Unsupported Voxel delta compression.");
+	}
+	ERR_FAIL_COND_V_MSG(payload.size() != payload_size, ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+
+	const uint8_t *stream = payload.ptr();
+	const size_t stream_size = payload.size();
+	size_t position = 0;
+
+	uint64_t since_version = 0;
+	uint64_t version = 0;
+	uint32_t delta_width = 0, delta_height = 0, delta_depth = 0, delta_chunk_size = 0, attribute_count = 0;
+	bool valid = _read_delta_value(stream, stream_size, position, since_version) &&
+			_read_delta_value(stream, stream_size, position, version) &&
+			_read_delta_value(stream, stream_size, position, delta_width) &&
+			_read_delta_value(stream, stream_size, position, delta_height) &&
+			_read_delta_value(stream, stream_size, position, delta_depth) &&
+			_read_delta_value(stream, stream_size, position, delta_chunk_size) &&
+			_read_delta_value(stream, stream_size, position, attribute_count);
+	ERR_FAIL_COND_V_MSG(!valid, ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+	ERR_FAIL_COND_V_MSG(delta_width != width || delta_height != height || delta_depth != depth || delta_chunk_size != chunk_size, 
+			ERR_INVALID_DATA, "Voxel delta was encoded from a storage with a different size.");
+	ERR_FAIL_COND_V_MSG(attribute_count != _attribute_buffers.size(), ERR_INVALID_DATA, "Voxel delta was encoded with a different Attribute Object.");
+	ERR_FAIL_COND_V_MSG(since_version != _applied_delta_version, ERR_INVALID_DATA, 
+			"Voxel delta is out of sequence (missing, duplicated or reordered), resync with encode_delta(get_applied_delta_version()).");
+	for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+		uint32_t voxel_stride = 0;
+		ERR_FAIL_COND_V_MSG(!_read_delta_value(stream, stream_size, position, voxel_stride), ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+		ERR_FAIL_COND_V_MSG(voxel_stride != _attribute_voxel_strides[attribute_index], 
+				ERR_INVALID_DATA, "Voxel delta was encoded with a different Attribute Object.");
+	}
+
+	uint32_t chunk_count = 0;
+	ERR_FAIL_COND_V_MSG(!_read_delta_value(stream, stream_size, position, chunk_count), ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+	const size_t chunks_position = position;
+
+	// Validate every chunk before applying any of them, so that a corrupt delta leaves the storage untouched.
+	for (uint32_t i = 0; i < chunk_count; i++) {
+		uint32_t chunk_buffer_index = 0;
+		ERR_FAIL_COND_V_MSG(!_read_delta_value(stream, stream_size, position, chunk_buffer_index) || chunk_buffer_index >= _chunk_buffer.size(), 
+				ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+		ERR_FAIL_COND_V_MSG(!_decode_chunk_delta(stream, stream_size, position, chunk_buffer_index, false), 
+				ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+	}
+	ERR_FAIL_COND_V_MSG(position != stream_size, ERR_FILE_CORRUPT, "Voxel delta payload is corrupt.");
+
+	position = chunks_position;
+	for (uint32_t i = 0; i < chunk_count; i++) {
+		uint32_t chunk_buffer_index = 0;
+		_read_delta_value(stream, stream_size, position, chunk_buffer_index);
+		ERR_FAIL_COND_V_MSG(!_decode_chunk_delta(stream, stream_size, position, chunk_buffer_index, true), 
+				ERR_FILE_CORRUPT, "Failed to apply a validated Voxel delta.");
+	}
+	VoxelStorageCounters::add(_counters.voxel_writes, (uint64_t)chunk_count * chunk_voxel_count);
+	_applied_delta_version = version;
+	return OK;
+}
+
+uint32_t DynamicVoxelStorage::get_voxel_data_hash() const {
+	uint32_t hash = HASH_MURMUR3_SEED;
+	for (size_t chunk_buffer_index = 0; chunk_buffer_index < _chunk_buffer.size(); chunk_buffer_index++) {
+		const uint32_t chunk_index = _chunk_buffer[chunk_buffer_index];
+		if (chunk_index == EMPTY_CHUNK) continue;
+
+		hash = hash_murmur3_one_32(chunk_buffer_index, hash);
+		for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
+			const size_t chunk_attribute_size = _get_chunk_attribute_size(attribute_index);
+			hash = hash_murmur3_buffer(_attribute_buffers[attribute_index].ptr() + (chunk_index * chunk_attribute_size), chunk_attribute_size, hash);
+		}
+	}
+	return hash_fmix32(hash);
+}
+
+void DynamicVoxelStorage::_label_component_chunk_task(void *p_state, uint32_t p_job_index) {
+	ComponentState *state = static_cast<ComponentState *>(p_state);
+	state->storage->_label_component_chunk(*state, p_job_index);
+}
+
+void DynamicVoxelStorage::_label_component_chunk(ComponentState &p_state, uint32_t p_job_index) {
+	ComponentChunkJob &job = p_state.jobs[p_job_index];
+	const size_t voxel_stride = p_state.voxel_stride;
+	const Vector3i &region_from = p_state.region_from;
+	const Vector3i &region_to = p_state.region_to;
+	const uint8_t *chunk_ptr = _attribute_buffers[p_state.attribute_index].ptr() + 
+			(job.chunk_index * chunk_size * chunk_size * chunk_size * voxel_stride);
+
+	const Vector3i box_size = job.to - job.from;
+	const uint32_t box_voxel_count = box_size.x * box_size.y * box_size.z;
+	const uint32_t row_stride = box_size.x;
+	const uint32_t slice_stride = box_size.x * box_size.y;
+
+	// First pass: union every occupied voxel with its occupied -X, -Y and -Z neighbours.
+	// Labels temporarily hold 1 for occupied voxels.
+	job.labels.resize(box_voxel_count);
+	util::UnionFind union_find;
+	union_find.reset(box_voxel_count);
+	for (int32_t z = 0; z < box_size.z; z++) {
+		for (int32_t y = 0; y < box_size.y; y++) {
+			const uint8_t *row_ptr = chunk_ptr + util::index_3d(
+					job.from.x - job.chunk_origin.x, job.from.y - job.chunk_origin.y + y, job.from.z - job.chunk_origin.z + z,
+					chunk_size, chunk_size, chunk_size) * voxel_stride;
+			for (int32_t x = 0; x < box_size.x; x++) {
+				const uint32_t index = util::index_3d(x, y, z, box_size.x, box_size.y, box_size.z);
+				const uint8_t *voxel_ptr = row_ptr + (x * voxel_stride);
+				uint8_t occupied = 0;
+				for (size_t i = 0; i < voxel_stride; i++) {
+					occupied |= voxel_ptr[i];
+				}
+				job.labels[index] = occupied != 0;
+				if (!occupied) continue;
+
+				if (x > 0 && job.labels[index - 1]) union_find.unite(index, index - 1);
+				if (y > 0 && job.labels[index - row_stride]) union_find.unite(index, index - row_stride);
+				if (z > 0 && job.labels[index - slice_stride]) union_find.unite(index, index - slice_stride);
+			}
+		}
+	}
+
+	// Second pass: turn the sets into compact local ids and gather their info.
+	// Roots are the smallest index of their set, so they always get their id before the rest of their set.
+	for (int32_t z = 0; z < box_size.z; z++) {
+		for (int32_t y = 0; y < box_size.y; y++) {
+			for (int32_t x = 0; x < box_size.x; x++) {
+				const uint32_t index = util::index_3d(x, y, z, box_size.x, box_size.y, box_size.z);
+				if (!job.labels[index]) continue;
+
+				const uint32_t root = union_find.find(index);
+				const Vector3i position = job.from + Vector3i(x, y, z);
+				if (root == index) {
+					ComponentInfo component;
+					component.from = position;
+					component.to = position + Vector3i(1, 1, 1);
+					job.components.push_back(component);
+					job.labels[index] = job.components.size();
+				} else {
+					job.labels[index] = job.labels[root];
+				}
+
+				ComponentInfo &component = job.components[job.labels[index] - 1];
+				component.voxel_count++;
+				for (int axis = 0; axis < 3; axis++) {
+					component.from[axis] = MIN(component.from[axis], position[axis]);
+					component.to[axis] = MAX(component.to[axis], position[axis] + 1);
+					component.touches_region_border = component.touches_region_border || 
+							position[axis] == region_from[axis] || position[axis] == region_to[axis] - 1;
+				}
+			}
+		}
+	}
+}
+
+void DynamicVoxelStorage::_apply_brush_chunk_task(void *p_state, uint32_t p_job_index) {
+	const BrushState *state = static_cast<const BrushState *>(p_state);
+	state->storage->_apply_brush_chunk(*state, p_job_index);
+}
+
+void DynamicVoxelStorage::_apply_brush_chunk(const BrushState &p_state, uint32_t p_job_index) {
+	const BrushChunkJob &job = p_state.jobs[p_job_index];
+	switch (p_state.type) {
+		case VoxelAttributeDescriptor::TYPE_FLOAT32:
+			_apply_brush_chunk_rows<float>(p_state, job);
+			break;
+		case VoxelAttributeDescriptor::TYPE_FLOAT64:
+			_apply_brush_chunk_rows<double>(p_state, job);
+			break;
+		case VoxelAttributeDescriptor::TYPE_INTEGER8:
+			_apply_brush_chunk_rows<uint8_t>(p_state, job);
+			break;
+		case VoxelAttributeDescriptor::TYPE_INTEGER16:
+			_apply_brush_chunk_rows<uint16_t>(p_state, job);
+			break;
+		case VoxelAttributeDescriptor::TYPE_INTEGER32:
+			_apply_brush_chunk_rows<uint32_t>(p_state, job);
+			break;
+		case VoxelAttributeDescriptor::TYPE_INTEGER64:
+			_apply_brush_chunk_rows<uint64_t>(p_state, job);
+			break;
+	}
+	_allocated_chunk_info[job.chunk_index].voxel_counter = _count_occupied_voxels(job.chunk_index);
+}
+
+// Converts a blended brush value to the type of an attribute component.
+template <typename T>
+static T _brush_value_to_component(float p_value) {
+	if constexpr (std::is_floating_point_v<T>) {
+		return (T)p_value;
+	} else {
+		// Integer attributes are treated as unsigned, rounded and clamped to their range.
+		return (T)CLAMP(Math::floor((double)p_value + 0.5), 0.0, (double)std::numeric_limits<T>::max());
+	}
+}
+
+template <typename T>
+void DynamicVoxelStorage::_apply_brush_chunk_rows(const BrushState &p_state, const BrushChunkJob &p_job) {
+	const VoxelBrush *brush = p_state.brush;
+	const size_t voxel_stride = p_state.voxel_stride;
+	const size_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+	uint8_t *chunk_ptr = _attribute_buffers[p_state.attribute_index].ptr() + 
+			(p_job.chunk_index * chunk_voxel_count * voxel_stride) + p_state.component_offset;
+	const size_t row_length = p_job.to.x - p_job.from.x;
+
+	// Chunks entirely inside or outside of the brush have the same coverage everywhere, so blending boils down to
+	// storing a single value (Smooth Blend inside, and Subtract inside / Intersect outside on unsigned components),
+	// or to taking the min (the same on floating point components, which can be negative) or max (Union inside) with it.
+	if (p_job.constant_coverage >= 0.0f) {
+		enum {
+			CONSTANT_STORE,
+			CONSTANT_MIN,
+			CONSTANT_MAX,
+			CONSTANT_NONE
+		} constant_mode = CONSTANT_NONE;
+		T constant_value = T();
+		const VoxelBrush::Operation operation = brush->get_operation();
+		const bool is_inside = p_job.constant_coverage == 1.0f;
+		const bool is_outside = p_job.constant_coverage == 0.0f;
+		if ((operation == VoxelBrush::OPERATION_SUBTRACT && is_inside) || (operation == VoxelBrush::OPERATION_INTERSECT && is_outside)) {
+			constant_mode = std::is_floating_point_v<T> ? CONSTANT_MIN : CONSTANT_STORE;
+		} else if (operation == VoxelBrush::OPERATION_SMOOTH_BLEND && is_inside) {
+			constant_mode = CONSTANT_STORE;
+			constant_value = _brush_value_to_component<T>(brush->get_value());
+		} else if (operation == VoxelBrush::OPERATION_UNION && is_inside) {
+			constant_mode = CONSTANT_MAX;
+			constant_value = _brush_value_to_component<T>(brush->get_value());
+		}
+
+		if (constant_mode != CONSTANT_NONE) {
+			for (int32_t z = p_job.from.z; z < p_job.to.z; z++) {
+				for (int32_t y = p_job.from.y; y < p_job.to.y; y++) {
+					uint8_t *row_ptr = chunk_ptr + util::index_3d(
+							p_job.from.x - p_job.chunk_origin.x, y - p_job.chunk_origin.y, z - p_job.chunk_origin.z,
+							chunk_size, chunk_size, chunk_size) * voxel_stride;
+					switch (constant_mode) {
+						case CONSTANT_STORE:
+							for (size_t i = 0; i < row_length; i++) {
+								*reinterpret_cast<T *>(row_ptr + (i * voxel_stride)) = constant_value;
+							}
+							break;
+						case CONSTANT_MIN:
+							for (size_t i = 0; i < row_length; i++) {
+								T *component_ptr = reinterpret_cast<T *>(row_ptr + (i * voxel_stride));
+								*component_ptr = MIN(*component_ptr, constant_value);
+							}
+							break;
+						case CONSTANT_MAX:
+							for (size_t i = 0; i < row_length; i++) {
+								T *component_ptr = reinterpret_cast<T *>(row_ptr + (i * voxel_stride));
+								*component_ptr = MAX(*component_ptr, constant_value);
+							}
+							break;
+						default:
+							break;
+					}
+				}
+			}
+			return;
+		}
+	}
+
+	// Rows are padded up to the SIMD width, the padding is never written back.
+	const size_t padded_row_length = ((row_length + util::Float4::WIDTH - 1) / util::Float4::WIDTH) * util::Float4::WIDTH;
+	LocalVector<float> distances;
+	LocalVector<float> values;
+	distances.resize(padded_row_length);
+	values.resize(padded_row_length);
+	for (float &value : values) {
+		value = 0.0f;
+	}
+
+	const bool evaluate = p_job.constant_coverage < 0.0f;
+	for (int32_t z = p_job.from.z; z < p_job.to.z; z++) {
+		for (int32_t y = p_job.from.y; y < p_job.to.y; y++) {
+			uint8_t *row_ptr = chunk_ptr + util::index_3d(
+					p_job.from.x - p_job.chunk_origin.x, y - p_job.chunk_origin.y, z - p_job.chunk_origin.z,
+					chunk_size, chunk_size, chunk_size) * voxel_stride;
+
+			for (size_t i = 0; i < row_length; i++) {
+				values[i] = (float)*reinterpret_cast<const T *>(row_ptr + (i * voxel_stride));
+			}
+
+			if (evaluate) {
+				brush->get_row_distances(p_job.from.x, y, z, row_length, distances.ptr());
+			}
+			brush->blend_row(evaluate ? distances.ptr() : nullptr, p_job.constant_coverage, values.ptr(), row_length);
+
+			for (size_t i = 0; i < row_length; i++) {
+				*reinterpret_cast<T *>(row_ptr + (i * voxel_stride)) = _brush_value_to_component<T>(values[i]);
+			}
+		}
 	}
 }
 
 void DynamicVoxelStorage::clear() {
-	resize_and_clear(chunk_size, width, height, depth);
+	resize_and_clear(width, height, depth, chunk_size);
 }
 
 void DynamicVoxelStorage::_bind_methods() {
@@ -94,9 +1211,32 @@ void DynamicVoxelStorage::_bind_methods() {
 			PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), 
 			"", "get_depth");
 
+	ClassDB::bind_method(D_METHOD("get_allocated_chunk_count"), &DynamicVoxelStorage::get_allocated_chunk_count);
+	ClassDB::bind_method(D_METHOD("get_reusable_chunk_count"), &DynamicVoxelStorage::get_reusable_chunk_count);
+	ClassDB::bind_method(D_METHOD("get_occupied_voxel_count"), &DynamicVoxelStorage::get_occupied_voxel_count);
+
+	ClassDB::bind_method(D_METHOD("get_statistics"), &DynamicVoxelStorage::get_statistics);
+	ClassDB::bind_method(D_METHOD("reset_statistics_counters"), &DynamicVoxelStorage::reset_statistics_counters);
+
 	ClassDB::bind_method(D_METHOD("resize_and_clear", "width", "height", "depth", "chunk_size"), &DynamicVoxelStorage::resize_and_clear);
 	ClassDB::bind_method(D_METHOD("clear"), &DynamicVoxelStorage::clear);
 
+	ClassDB::bind_method(D_METHOD("apply_brush", "brush", "attribute_index", "component_index"), &DynamicVoxelStorage::apply_brush, DEFVAL(0));
+
+	ClassDB::bind_method(D_METHOD("get_version"), &DynamicVoxelStorage::get_version);
+	ClassDB::bind_method(D_METHOD("get_applied_delta_version"), &DynamicVoxelStorage::get_applied_delta_version);
+	ClassDB::bind_method(D_METHOD("encode_delta", "since_version"), &DynamicVoxelStorage::encode_delta);
+	ClassDB::bind_method(D_METHOD("apply_delta", "delta"), &DynamicVoxelStorage::apply_delta);
+	ClassDB::bind_method(D_METHOD("get_voxel_data_hash"), &DynamicVoxelStorage::get_voxel_data_hash);
+
+	ClassDB::bind_method(D_METHOD("get_edit_region"), &DynamicVoxelStorage::get_edit_region);
+	ClassDB::bind_method(D_METHOD("clear_edit_region"), &DynamicVoxelStorage::clear_edit_region);
+
+	ClassDB::bind_method(D_METHOD("find_connected_components", "attribute_index", "from", "to", "extract"), 
+			&DynamicVoxelStorage::find_connected_components, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("find_connected_components_in_edit_region", "attribute_index", "margin", "extract"), 
+			&DynamicVoxelStorage::find_connected_components_in_edit_region, DEFVAL(8), DEFVAL(false));
+
 	ClassDB::bind_method(D_METHOD("set_voxel_attribute_v2f32", "attribute_index", "x", "y", "z", "value"), 
 			&DynamicVoxelStorage::set_voxel_attribute_vector<Vector2, 2, float, VoxelAttributeDescriptor::TYPE_FLOAT32, false>);
 	ClassDB::bind_method(D_METHOD("set_voxel_attribute_v2f64", "attribute_index", "x", "y", "z", "value"), 
@@ -237,8 +1377,10 @@ void DynamicVoxelStorage::_bind_methods() {
 }
 
 DynamicVoxelStorage::DynamicVoxelStorage() {
-	resize_and_clear(chunk_size, width, height, depth);
+	VoxelStatistics::register_storage(&_counters);
+	resize_and_clear(width, height, depth, chunk_size);
 }
 
 DynamicVoxelStorage::~DynamicVoxelStorage() {
+	VoxelStatistics::unregister_storage(&_counters);
 }
@@ -1,12 +1,20 @@
 #pragma once
 
 #include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/classes/global_constants.hpp>
 #include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
 
 #include <godot_cpp/templates/vector.hpp>
 
+#include <cstring>
+
 #include "voxel_attribute_object.hpp"
+#include "voxel_brush.hpp"
+#include "voxel_statistics.hpp"
 #include "util.hpp"
 
 using namespace godot;
@@ -41,9 +49,19 @@ protected:
 	// A chunk that is set to "UINT32_MAX" is empty.
 	TightLocalVector<uint32_t> _chunk_buffer;
 
+	// Incremented on every edit. Used to find what changed since a given version (see encode_delta()).
+	uint64_t _version = 0;
+	// The version at which each chunk in the grid was last modified (or freed).
+	TightLocalVector<uint64_t> _chunk_versions;
+	// The source version of the last delta applied to this storage (see apply_delta()).
+	uint64_t _applied_delta_version = 0;
+
 	// Stores a buffer per-attribute (in the order they appear in the descriptors array within the Attribute Object)
 	// that contains all of the Voxel data for the non-empty chunks.
 	LocalVector<LocalVector<uint8_t>> _attribute_buffers;
+	// The size in bytes of a single voxel within each of the attribute buffers (component size * component count).
+	// Cached by _init_buffers() so the per-voxel paths don't have to go through the Attribute Object.
+	LocalVector<size_t> _attribute_voxel_strides;
 
 	// While the other data can be directly uploaded to the GPU, this is data that only the CPU needs to keep track of.
 	struct AllocatedChunkInfo {
@@ -56,17 +74,43 @@ protected:
 	// Used to prevent unnecessary buffer growth.
 	LocalVector<uint32_t> _reusable_chunk_queue;
 
+	// Runtime statistics, see get_statistics() and VoxelStatistics.
+	// Mutable so that read only bulk paths (e.g. encode_delta()) can be timed too.
+	mutable VoxelStorageCounters _counters;
+
+	// The region touched by edits since it was last cleared (from inclusive, to exclusive).
+	bool _has_edit_region = false;
+	Vector3i _edit_region_from;
+	Vector3i _edit_region_to;
+
+	_ALWAYS_INLINE_ void _expand_edit_region(const Vector3i &p_from, const Vector3i &p_to) {
+		if (!_has_edit_region) {
+			_has_edit_region = true;
+			_edit_region_from = p_from;
+			_edit_region_to = p_to;
+			return;
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			_edit_region_from[axis] = MIN(_edit_region_from[axis], p_from[axis]);
+			_edit_region_to[axis] = MAX(_edit_region_to[axis], p_to[axis]);
+		}
+	}
+
 	void _init_buffers();
 
+	// The size in bytes of a single chunk within the buffer of the given attribute.
+	_ALWAYS_INLINE_ size_t _get_chunk_attribute_size(size_t p_attribute_index) const {
+		return (chunk_size * chunk_size * chunk_size) * _attribute_voxel_strides[p_attribute_index];
+	}
+
 	// Allocates the memory required for a new chunk by appending extra room on the end of each of the attribute buffers.
 	_ALWAYS_INLINE_ uint32_t _allocate_new_chunk() {
 		if (_attribute_buffers.is_empty()) return EMPTY_CHUNK;
+		VODOT_SCOPED_TIMER(_counters.allocation_time_nsec);
 		uint32_t allocated_chunk_index = 0;
 		{
 			// We get the index of the chunk we are about to allocate by dividing the size of the first attribute buffer by the byte size of each chunk.
-			const Ref<VoxelAttributeDescriptor> &attribute_info = get_voxel_attribute_object()->descriptors[0];
-			allocated_chunk_index = _attribute_buffers[0].size() / ((chunk_size * chunk_size * chunk_size) * 
-					attribute_info->get_component_size() * attribute_info->get_num_components());
+			allocated_chunk_index = _attribute_buffers[0].size() / _get_chunk_attribute_size(0);
 			
 			 // Allocate a new info struct.
 			_allocated_chunk_info.reserve(allocated_chunk_index+1);
@@ -75,10 +119,13 @@ protected:
 
 		for (size_t i = 0; i < _attribute_buffers.size(); i++) {
 			LocalVector<uint8_t> &buffer = _attribute_buffers[i];
-			const Ref<VoxelAttributeDescriptor> &attribute_info = get_voxel_attribute_object()->descriptors[i];
-			buffer.resize(buffer.size() + ((chunk_size * chunk_size * chunk_size) * 
-					attribute_info->get_component_size() * attribute_info->get_num_components()));
+			const size_t chunk_attribute_size = _get_chunk_attribute_size(i);
+			buffer.resize(buffer.size() + chunk_attribute_size);
+			// The voxel counters are derived from the buffer contents, so new chunks have to start out empty.
+			memset(buffer.ptr() + (buffer.size() - chunk_attribute_size), 0, chunk_attribute_size);
 		}
+		VoxelStorageCounters::add(_counters.chunk_allocations);
+		VoxelStorageCounters::set(_counters.allocated_chunks, _allocated_chunk_info.size());
 		return allocated_chunk_index;
 	}
 
@@ -93,15 +140,24 @@ protected:
 			// (we can assume it's already initialized to empty, as otherwise it wouldn't have been freed in the first place)
 			chunk_index = _reusable_chunk_queue[_reusable_chunk_queue.size()-1];
 			_reusable_chunk_queue.resize(_reusable_chunk_queue.size()-1);
+			VoxelStorageCounters::add(_counters.chunk_reuses);
+			VoxelStorageCounters::set(_counters.reusable_chunks, _reusable_chunk_queue.size());
 		}
 		return chunk_index;
 	}
 
-	_ALWAYS_INLINE_ uint32_t &_get_chunk_index(size_t p_x, size_t p_y, size_t p_z) {
-		size_t chunk_buffer_index = util::index_3d(
+	_ALWAYS_INLINE_ size_t _get_chunk_buffer_index(size_t p_x, size_t p_y, size_t p_z) const {
+		return util::index_3d(
 				p_x / chunk_size, p_y / chunk_size, p_z / chunk_size, 
 				width / chunk_size, height / chunk_size, depth / chunk_size);
-		return _chunk_buffer[chunk_buffer_index];
+	}
+
+	_ALWAYS_INLINE_ uint32_t &_get_chunk_index(size_t p_x, size_t p_y, size_t p_z) {
+		return _chunk_buffer[_get_chunk_buffer_index(p_x, p_y, p_z)];
+	}
+
+	_ALWAYS_INLINE_ void _mark_chunk_modified(size_t p_chunk_buffer_index) {
+		_chunk_versions[p_chunk_buffer_index] = ++_version;
 	}
 
 	_ALWAYS_INLINE_ bool _init_chunk_index(uint32_t &p_chunk_index, size_t p_attribute_index, size_t p_x, size_t p_y, size_t p_z, bool p_is_zero_write) {
@@ -115,29 +171,125 @@ protected:
 
 	_ALWAYS_INLINE_ bool _check_voxel(uint32_t p_chunk_index, size_t p_chunk_voxel_index) {
 		for (size_t attribute_index = 0; attribute_index < _attribute_buffers.size(); attribute_index++) {
-			const Ref<VoxelAttributeDescriptor> &attribute_info = get_voxel_attribute_object()->descriptors[attribute_index];
-			const LocalVector<uint8_t> &buffer = _attribute_buffers[attribute_index];
-			const uint8_t *attribute_ptr = &buffer[
-				((p_chunk_index * (chunk_size * chunk_size * chunk_size)) + p_chunk_voxel_index)
-					* attribute_info->get_component_size() * attribute_info->get_num_components()];
-			for (size_t i = 0; i < attribute_info->get_component_size() * attribute_info->get_num_components(); i++) {
+			const size_t voxel_stride = _attribute_voxel_strides[attribute_index];
+			const uint8_t *attribute_ptr = _attribute_buffers[attribute_index].ptr() + 
+					((p_chunk_index * (chunk_size * chunk_size * chunk_size)) + p_chunk_voxel_index) * voxel_stride;
+			for (size_t i = 0; i < voxel_stride; i++) {
 				if (attribute_ptr[i] != 0) return true;
 			}
 		}
 		return false;
 	}
 
-	_ALWAYS_INLINE_ void _mark_chunk_as_reusable_if_chunk_is_now_empty(uint32_t &p_chunk_index, size_t p_chunk_voxel_index, bool p_is_zero_write) {
-		if (p_is_zero_write) {
-			if (!_check_voxel(p_chunk_index, p_chunk_voxel_index)) {
-				_allocated_chunk_info[p_chunk_index].voxel_counter--;
-				if (_allocated_chunk_info[p_chunk_index].voxel_counter == 0) {
-					_reusable_chunk_queue.push_back(p_chunk_index);
-					p_chunk_index = EMPTY_CHUNK;
-				}
+	_ALWAYS_INLINE_ void _free_chunk(uint32_t &p_chunk_index) {
+		_reusable_chunk_queue.push_back(p_chunk_index);
+		p_chunk_index = EMPTY_CHUNK;
+		VoxelStorageCounters::add(_counters.chunk_frees);
+		VoxelStorageCounters::set(_counters.reusable_chunks, _reusable_chunk_queue.size());
+	}
+
+	// Counts the voxels of a chunk that have any non-zero attribute data (what the voxel counter of the chunk should be).
+	uint32_t _count_occupied_voxels(uint32_t p_chunk_index) const;
+
+	// Keeps the voxel counter of a chunk up to date after a write, and frees the chunk once its last voxel is cleared.
+	// "p_was_occupied" is whether the voxel had any non-zero attribute data *before* the write.
+	// The new state is always read back from the buffers, as the written value may have been truncated to zero.
+	_ALWAYS_INLINE_ void _update_chunk_voxel_counter(uint32_t &p_chunk_index, size_t p_chunk_voxel_index, bool p_was_occupied) {
+		bool is_occupied = _check_voxel(p_chunk_index, p_chunk_voxel_index);
+
+		AllocatedChunkInfo &chunk_info = _allocated_chunk_info[p_chunk_index];
+		if (is_occupied != p_was_occupied) {
+			if (is_occupied) {
+				chunk_info.voxel_counter++;
+			} else {
+				chunk_info.voxel_counter--;
 			}
 		}
+		// Also covers a chunk that was just allocated for a write that turned out to be zero.
+		if (chunk_info.voxel_counter == 0) {
+			_free_chunk(p_chunk_index);
+		}
 	}
+	// A chunk (or the part of it that overlaps the brush) that a brush is applied to.
+	struct BrushChunkJob {
+		uint32_t grid_index = 0;
+		uint32_t chunk_index = 0;
+		Vector3i chunk_origin;
+		// The range of voxels to process, from (inclusive) to (exclusive).
+		Vector3i from;
+		Vector3i to;
+		// The chunk is entirely inside (1) or outside (0) of the brush, so it doesn't need to be evaluated per voxel.
+		// Negative if it does.
+		float constant_coverage = -1.0f;
+	};
+
+	// State shared with the worker threads while a brush is being applied.
+	// Chunks are all allocated up front, so the threads only ever touch the memory of their own chunk.
+	struct BrushState {
+		DynamicVoxelStorage *storage = nullptr;
+		const VoxelBrush *brush = nullptr;
+		VoxelAttributeDescriptor::Type type = VoxelAttributeDescriptor::TYPE_INTEGER8;
+		size_t voxel_stride = 0;
+		size_t component_offset = 0;
+		size_t attribute_index = 0;
+		LocalVector<BrushChunkJob> jobs;
+	};
+
+	// Entry point of the WorkerThreadPool's native group task, "p_state" is the BrushState.
+	static void _apply_brush_chunk_task(void *p_state, uint32_t p_job_index);
+	void _apply_brush_chunk(const BrushState &p_state, uint32_t p_job_index);
+	template <typename T>
+	void _apply_brush_chunk_rows(const BrushState &p_state, const BrushChunkJob &p_job);
+
+	struct ComponentInfo {
+		uint64_t voxel_count = 0;
+		Vector3i from;
+		Vector3i to;
+		bool touches_region_border = false;
+	};
+
+	// The part of a non-empty chunk that overlaps the region components are searched in.
+	struct ComponentChunkJob {
+		uint32_t chunk_index = 0;
+		Vector3i chunk_origin;
+		Vector3i from;
+		Vector3i to;
+		// Per voxel of the from / to box: 0 for empty voxels, otherwise the (1 based) local component id.
+		LocalVector<uint32_t> labels;
+		// Per local component, in the order of their ids.
+		LocalVector<ComponentInfo> components;
+		// Where the local components of this chunk start within the global union-find.
+		uint32_t label_offset = 0;
+
+		_ALWAYS_INLINE_ uint32_t get_label(int32_t p_x, int32_t p_y, int32_t p_z) const {
+			Vector3i box_size = to - from;
+			return labels[util::index_3d(p_x - from.x, p_y - from.y, p_z - from.z, box_size.x, box_size.y, box_size.z)];
+		}
+	};
+
+	// State shared with the worker threads while labeling connected components.
+	struct ComponentState {
+		DynamicVoxelStorage *storage = nullptr;
+		size_t attribute_index = 0;
+		size_t voxel_stride = 0;
+		Vector3i region_from;
+		Vector3i region_to;
+		LocalVector<ComponentChunkJob> jobs;
+	};
+
+	// Entry point of the WorkerThreadPool's native group task, "p_state" is the ComponentState.
+	static void _label_component_chunk_task(void *p_state, uint32_t p_job_index);
+	void _label_component_chunk(ComponentState &p_state, uint32_t p_job_index);
+
+	// Writes the voxel data of a chunk to / reads it from a delta stream, see encode_delta().
+	// Without "p_apply" the chunk is only validated (and skipped over), the storage is left untouched.
+	void _encode_chunk_delta(LocalVector<uint8_t> &r_stream, uint32_t p_chunk_index) const;
+	bool _decode_chunk_delta(const uint8_t *p_stream, size_t p_stream_size, size_t &r_position, size_t p_chunk_buffer_index, bool p_apply);
+	// The largest a single chunk can get within a delta stream.
+	uint64_t _get_max_chunk_delta_size() const;
+
+	// Copies every attribute of a voxel from another storage (using the same Attribute Object) into an empty voxel of this one.
+	void _copy_voxel(const DynamicVoxelStorage &p_source, uint32_t p_source_chunk_index, size_t p_source_chunk_voxel_index, size_t p_x, size_t p_y, size_t p_z);
 public:
 	Ref<VoxelAttributeObject> get_voxel_attribute_object() const;
 	void set_voxel_attribute_object(const Ref<VoxelAttributeObject> &p_voxel_attribute_object);
@@ -147,7 +299,55 @@ public:
 	size_t get_height() const;
 	size_t get_depth() const;
 
+	// The amount of chunk slots currently allocated within the attribute buffers (including reusable ones).
+	size_t get_allocated_chunk_count() const;
+	// The amount of allocated chunk slots that are currently empty and waiting to be reused.
+	size_t get_reusable_chunk_count() const;
+	// The amount of voxels that have any non-zero attribute data.
+	uint64_t get_occupied_voxel_count() const;
+
+	// Returns a snapshot of the memory usage and the event counters of this storage.
+	Dictionary get_statistics() const;
+	void reset_statistics_counters();
+
 	void resize_and_clear(size_t p_width, size_t p_height, size_t p_depth, size_t p_chunk_size);
+
+	// Applies a signed distance field brush to one component of an attribute.
+	// Chunks entirely outside of the brush are skipped, chunks entirely inside are filled without evaluating the brush,
+	// and the rest are evaluated row by row, spread over the WorkerThreadPool.
+	// Returns the amount of voxels that were written.
+	int64_t apply_brush(const Ref<VoxelBrush> &p_brush, size_t p_attribute_index, size_t p_component_index = 0);
+
+	// Incremented on every edit, pass the version a delta was encoded at to the next encode_delta() call.
+	uint64_t get_version() const;
+
+	// Encodes every chunk modified after "p_since_version" into a compact binary stream that can be applied to another storage
+	// of the same size and Attribute Object with apply_delta(). Chunks are stored as freed, uniform, or per attribute uniform,
+	// run length encoded or raw (whichever is smallest), and the whole stream is then compressed with FastLZ.
+	PackedByteArray encode_delta(uint64_t p_since_version) const;
+	// Decodes a stream from encode_delta() straight into the attribute buffers.
+	// Deltas have to be applied in order: one encoded since any other version than get_applied_delta_version() is rejected.
+	Error apply_delta(const PackedByteArray &p_delta);
+	// The version of the source storage this one was last brought up to by apply_delta().
+	// Encoding the next delta since this version resyncs it. Goes back to 0 when this storage is cleared or resized.
+	uint64_t get_applied_delta_version() const;
+
+	// A hash of all of the Voxel data, independent of where chunks happen to be within the attribute buffers.
+	// Useful for checking that two storages (e.g. a replicated one) hold the same data.
+	uint32_t get_voxel_data_hash() const;
+
+	// The bounds of every voxel edited since the edit region was last cleared.
+	AABB get_edit_region() const;
+	void clear_edit_region();
+
+	// Finds the 6-connected components of the voxels within a region (from inclusive, to exclusive)
+	// that have a non-zero value in the given (occupancy) attribute.
+	// Chunks are labeled in parallel and merged across their borders, empty chunks are skipped.
+	// Returns a Dictionary per component, largest first, with its "voxel_count", "bounds", whether it "touches_region_border"
+	// (in which case it may continue outside of the region) and, if "p_extract" is set, a copy of its voxels as a new "storage".
+	Array find_connected_components(size_t p_attribute_index, const Vector3i &p_from, const Vector3i &p_to, bool p_extract = false);
+	// Same as find_connected_components(), but limited to the edit region grown by "p_margin" voxels. Clears the edit region.
+	Array find_connected_components_in_edit_region(size_t p_attribute_index, int32_t p_margin = 8, bool p_extract = false);
 	void clear();
 
 	template <class T, size_t num_components, typename COMPONENT_T, VoxelAttributeDescriptor::Type COMPONENT_TYPE, bool unchecked = false>
@@ -158,13 +358,19 @@ public:
 			ERR_FAIL_COND_MSG(attribute_info->get_type() == COMPONENT_TYPE, "Attribute component type doesn't match Vector component type.");
 		}
 		bool is_zero_write = p_value == T();
+		VoxelStorageCounters::add(_counters.voxel_writes);
 
-		uint32_t &chunk_index = _get_chunk_index(p_x, p_y, p_z);
+		size_t chunk_buffer_index = _get_chunk_buffer_index(p_x, p_y, p_z);
+		uint32_t &chunk_index = _chunk_buffer[chunk_buffer_index];
+		bool was_empty_chunk = chunk_index == EMPTY_CHUNK;
 		if (!_init_chunk_index(chunk_index, p_attribute_index, p_x, p_y, p_z, is_zero_write)) return;
+		_expand_edit_region(Vector3i(p_x, p_y, p_z), Vector3i(p_x + 1, p_y + 1, p_z + 1));
+		_mark_chunk_modified(chunk_buffer_index);
 
 		size_t chunk_voxel_index = util::index_3d(
 				p_x % chunk_size, p_y % chunk_size, p_z % chunk_size,
 				chunk_size, chunk_size, chunk_size);
+		bool was_occupied = !was_empty_chunk && _check_voxel(chunk_index, chunk_voxel_index);
 		uint8_t *attribute_ptr = &attribute_buffer[
 				((chunk_index * (chunk_size * chunk_size * chunk_size)) + chunk_voxel_index)
 					* attribute_info->get_component_size() * attribute_info->get_num_components()];
@@ -181,7 +387,7 @@ public:
 			}
 		}
 
-		_mark_chunk_as_reusable_if_chunk_is_now_empty(chunk_index, chunk_voxel_index, is_zero_write);
+		_update_chunk_voxel_counter(chunk_index, chunk_voxel_index, was_occupied);
 	}
 
 	template <typename T, VoxelAttributeDescriptor::Type COMPONENT_TYPE, bool unchecked = false, typename PARAMETER_T = T>
@@ -191,20 +397,26 @@ public:
 		if constexpr (!unchecked) {
 			ERR_FAIL_COND_MSG(attribute_info->get_type() == COMPONENT_TYPE, "Attribute component type doesn't match value type.");
 		}
-		bool is_zero_write = p_value == 0;
+		bool is_zero_write = (T)p_value == 0;
+		VoxelStorageCounters::add(_counters.voxel_writes);
 
-		uint32_t &chunk_index = _get_chunk_index(p_x, p_y, p_z);
+		size_t chunk_buffer_index = _get_chunk_buffer_index(p_x, p_y, p_z);
+		uint32_t &chunk_index = _chunk_buffer[chunk_buffer_index];
+		bool was_empty_chunk = chunk_index == EMPTY_CHUNK;
 		if (!_init_chunk_index(chunk_index, p_attribute_index, p_x, p_y, p_z, is_zero_write)) return;
+		_expand_edit_region(Vector3i(p_x, p_y, p_z), Vector3i(p_x + 1, p_y + 1, p_z + 1));
+		_mark_chunk_modified(chunk_buffer_index);
 
 		size_t chunk_voxel_index = util::index_3d(
 				p_x % chunk_size, p_y % chunk_size, p_z % chunk_size,
 				chunk_size, chunk_size, chunk_size);
+		bool was_occupied = !was_empty_chunk && _check_voxel(chunk_index, chunk_voxel_index);
 		uint8_t *component_ptr = &attribute_buffer[
 				((((chunk_index * (chunk_size * chunk_size * chunk_size)) + chunk_voxel_index) 
 					* attribute_info->get_num_components()) + p_component) 
 					* attribute_info->get_component_size()];
 		*reinterpret_cast<T*>(component_ptr) = (T)p_value;
-		_mark_chunk_as_reusable_if_chunk_is_now_empty(chunk_index, chunk_voxel_index, is_zero_write);
+		_update_chunk_voxel_counter(chunk_index, chunk_voxel_index, was_occupied);
 	}
 
 	DynamicVoxelStorage();
@@ -9,6 +9,8 @@
 #include "voxel_attribute_descriptor.hpp"
 #include "voxel_attribute_object.hpp"
 #include "dynamic_voxel_storage.hpp"
+#include "voxel_brush.hpp"
+#include "voxel_statistics.hpp"
 
 using namespace godot;
 
@@ -19,6 +21,11 @@ void gdextension_initialize(ModuleInitializationLevel p_level)
 		ClassDB::register_class<VoxelAttributeDescriptor>();
 		ClassDB::register_class<VoxelAttributeObject>();
 		ClassDB::register_class<DynamicVoxelStorage>();
+		ClassDB::register_class<VoxelBrush>();
+		// Only instanced internally to back the Performance monitors.
+		ClassDB::register_abstract_class<VoxelStatistics>();
+
+		VoxelStatistics::add_monitors();
 	}
 }
 
@@ -26,6 +33,7 @@ void gdextension_terminate(ModuleInitializationLevel p_level)
 {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE)
 	{
+		VoxelStatistics::remove_monitors();
 	}
 }
 
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <godot_cpp/core/defs.hpp>
+
+#include <cmath>
+
+// A minimal 4-wide float vector for the hot per-voxel loops.
+// Maps onto SSE on x86-64 and NEON on ARM64, with a scalar fallback for everything else.
+#if defined(__SSE2__) || defined(_M_X64)
+#define VODOT_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define VODOT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace util {
+
+struct Float4 {
+#if defined(VODOT_SIMD_SSE)
+	__m128 v;
+#elif defined(VODOT_SIMD_NEON)
+	float32x4_t v;
+#else
+	float v[4];
+#endif
+
+	static constexpr size_t WIDTH = 4;
+
+	_ALWAYS_INLINE_ static Float4 splat(float p_value) {
+		Float4 result;
+#if defined(VODOT_SIMD_SSE)
+		result.v = _mm_set1_ps(p_value);
+#elif defined(VODOT_SIMD_NEON)
+		result.v = vdupq_n_f32(p_value);
+#else
+		for (size_t i = 0; i < WIDTH; i++) result.v[i] = p_value;
+#endif
+		return result;
+	}
+
+	// Returns { p_start, p_start + 1, p_start + 2, p_start + 3 }.
+	_ALWAYS_INLINE_ static Float4 ramp(float p_start) {
+		Float4 result;
+#if defined(VODOT_SIMD_SSE)
+		result.v = _mm_add_ps(_mm_set1_ps(p_start), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+#elif defined(VODOT_SIMD_NEON)
+		const float offsets[WIDTH] = { 0.0f, 1.0f, 2.0f, 3.0f };
+		result.v = vaddq_f32(vdupq_n_f32(p_start), vld1q_f32(offsets));
+#else
+		for (size_t i = 0; i < WIDTH; i++) result.v[i] = p_start + (float)i;
+#endif
+		return result;
+	}
+
+	_ALWAYS_INLINE_ static Float4 load(const float *p_ptr) {
+		Float4 result;
+#if defined(VODOT_SIMD_SSE)
+		result.v = _mm_loadu_ps(p_ptr);
+#elif defined(VODOT_SIMD_NEON)
+		result.v = vld1q_f32(p_ptr);
+#else
+		for (size_t i = 0; i < WIDTH; i++) result.v[i] = p_ptr[i];
+#endif
+		return result;
+	}
+
+	_ALWAYS_INLINE_ void store(float *p_ptr) const {
+#if defined(VODOT_SIMD_SSE)
+		_mm_storeu_ps(p_ptr, v);
+#elif defined(VODOT_SIMD_NEON)
+		vst1q_f32(p_ptr, v);
+#else
+		for (size_t i = 0; i < WIDTH; i++) p_ptr[i] = v[i];
+#endif
+	}
+};
+
+#if defined(VODOT_SIMD_SSE)
+#define VODOT_FLOAT4_BINARY_OP(m_name, m_sse, m_neon, m_scalar) \
+	_ALWAYS_INLINE_ Float4 m_name(Float4 a, Float4 b) { Float4 r; r.v = m_sse(a.v, b.v); return r; }
+#elif defined(VODOT_SIMD_NEON)
+#define VODOT_FLOAT4_BINARY_OP(m_name, m_sse, m_neon, m_scalar) \
+	_ALWAYS_INLINE_ Float4 m_name(Float4 a, Float4 b) { Float4 r; r.v = m_neon(a.v, b.v); return r; }
+#else
+#define VODOT_FLOAT4_BINARY_OP(m_name, m_sse, m_neon, m_scalar) \
+	_ALWAYS_INLINE_ Float4 m_name(Float4 a, Float4 b) { Float4 r; for (size_t i = 0; i < Float4::WIDTH; i++) r.v[i] = m_scalar(a.v[i], b.v[i]); return r; }
+#endif
+
+#define VODOT_SCALAR_ADD(a, b) ((a) + (b))
+#define VODOT_SCALAR_SUB(a, b) ((a) - (b))
+#define VODOT_SCALAR_MUL(a, b) ((a) * (b))
+
+VODOT_FLOAT4_BINARY_OP(operator+, _mm_add_ps, vaddq_f32, VODOT_SCALAR_ADD)
+VODOT_FLOAT4_BINARY_OP(operator-, _mm_sub_ps, vsubq_f32, VODOT_SCALAR_SUB)
+VODOT_FLOAT4_BINARY_OP(operator*, _mm_mul_ps, vmulq_f32, VODOT_SCALAR_MUL)
+VODOT_FLOAT4_BINARY_OP(min, _mm_min_ps, vminq_f32, std::fmin)
+VODOT_FLOAT4_BINARY_OP(max, _mm_max_ps, vmaxq_f32, std::fmax)
+
+#undef VODOT_SCALAR_ADD
+#undef VODOT_SCALAR_SUB
+#undef VODOT_SCALAR_MUL
+#undef VODOT_FLOAT4_BINARY_OP
+
+_ALWAYS_INLINE_ Float4 sqrt(Float4 a) {
+	Float4 r;
+#if defined(VODOT_SIMD_SSE)
+	r.v = _mm_sqrt_ps(a.v);
+#elif defined(VODOT_SIMD_NEON)
+	r.v = vsqrtq_f32(a.v);
+#else
+	for (size_t i = 0; i < Float4::WIDTH; i++) r.v[i] = std::sqrt(a.v[i]);
+#endif
+	return r;
+}
+
+_ALWAYS_INLINE_ Float4 abs(Float4 a) {
+	return max(a, Float4::splat(0.0f) - a);
+}
+
+_ALWAYS_INLINE_ Float4 clamp(Float4 a, Float4 p_min, Float4 p_max) {
+	return min(max(a, p_min), p_max);
+}
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <godot_cpp/templates/local_vector.hpp>
+
 namespace util {
 
 _ALWAYS_INLINE_ size_t index_3d(size_t x, size_t y, size_t z, size_t width, size_t height, size_t depth) {
@@ -26,4 +28,37 @@ struct VectorComponentUtilProxy<Vector4, TO_TYPE> {
 	}
 };
 
+// Disjoint set forest over the integers [0, size).
+// Sets are always represented by their smallest element, so when elements are united in increasing order,
+// the representative of an element is never larger than the element itself.
+struct UnionFind {
+	godot::LocalVector<uint32_t> parents;
+
+	void reset(uint32_t p_size) {
+		parents.resize(p_size);
+		for (uint32_t i = 0; i < p_size; i++) {
+			parents[i] = i;
+		}
+	}
+
+	_ALWAYS_INLINE_ uint32_t find(uint32_t p_element) {
+		while (parents[p_element] != p_element) {
+			// Path halving.
+			parents[p_element] = parents[parents[p_element]];
+			p_element = parents[p_element];
+		}
+		return p_element;
+	}
+
+	_ALWAYS_INLINE_ void unite(uint32_t p_a, uint32_t p_b) {
+		uint32_t root_a = find(p_a);
+		uint32_t root_b = find(p_b);
+		if (root_a < root_b) {
+			parents[root_b] = root_a;
+		} else if (root_b < root_a) {
+			parents[root_a] = root_b;
+		}
+	}
+};
+
 }
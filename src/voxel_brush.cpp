@@ -0,0 +1,313 @@
+#include "voxel_brush.hpp"
+
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/math.hpp>
+
+#include "simd.hpp"
+
+using namespace godot;
+using util::Float4;
+
+VoxelBrush::Shape VoxelBrush::get_shape() const {
+	return shape;
+}
+
+VoxelBrush::Operation VoxelBrush::get_operation() const {
+	return operation;
+}
+
+Vector3 VoxelBrush::get_position() const {
+	return position;
+}
+
+Vector3 VoxelBrush::get_end_position() const {
+	return end_position;
+}
+
+Vector3 VoxelBrush::get_extents() const {
+	return extents;
+}
+
+real_t VoxelBrush::get_radius() const {
+	return radius;
+}
+
+real_t VoxelBrush::get_falloff() const {
+	return falloff;
+}
+
+real_t VoxelBrush::get_value() const {
+	return value;
+}
+
+Ref<Noise> VoxelBrush::get_noise() const {
+	return noise;
+}
+
+real_t VoxelBrush::get_noise_strength() const {
+	return noise_strength;
+}
+
+void VoxelBrush::set_shape(Shape p_shape) {
+	shape = p_shape;
+	emit_changed();
+}
+
+void VoxelBrush::set_operation(Operation p_operation) {
+	operation = p_operation;
+	emit_changed();
+}
+
+void VoxelBrush::set_position(const Vector3 &p_position) {
+	position = p_position;
+	emit_changed();
+}
+
+void VoxelBrush::set_end_position(const Vector3 &p_end_position) {
+	end_position = p_end_position;
+	emit_changed();
+}
+
+void VoxelBrush::set_extents(const Vector3 &p_extents) {
+	extents = p_extents.abs();
+	emit_changed();
+}
+
+void VoxelBrush::set_radius(real_t p_radius) {
+	radius = MAX(p_radius, (real_t)0);
+	emit_changed();
+}
+
+void VoxelBrush::set_falloff(real_t p_falloff) {
+	falloff = MAX(p_falloff, (real_t)0);
+	emit_changed();
+}
+
+void VoxelBrush::set_value(real_t p_value) {
+	value = p_value;
+	emit_changed();
+}
+
+void VoxelBrush::set_noise(const Ref<Noise> &p_noise) {
+	noise = p_noise;
+	emit_changed();
+}
+
+void VoxelBrush::set_noise_strength(real_t p_noise_strength) {
+	noise_strength = p_noise_strength;
+	emit_changed();
+}
+
+float VoxelBrush::get_margin() const {
+	// Coverage reaches 0 half the falloff outside of the surface, and noise (in the [-1, 1] range) can push the surface out further.
+	return falloff * 0.5f + (noise.is_valid() ? Math::abs(noise_strength) : 0.0f);
+}
+
+AABB VoxelBrush::get_bounds() const {
+	float margin = get_margin();
+	switch (shape) {
+		default:
+		case SHAPE_SPHERE: {
+			Vector3 half_size = Vector3(radius, radius, radius) + Vector3(margin, margin, margin);
+			return AABB(position - half_size, half_size * 2);
+		}
+		case SHAPE_BOX: {
+			Vector3 half_size = extents + Vector3(margin, margin, margin);
+			return AABB(position - half_size, half_size * 2);
+		}
+		case SHAPE_CAPSULE: {
+			AABB bounds(position, Vector3());
+			bounds.expand_to(end_position);
+			return bounds.grow(radius + margin);
+		}
+	}
+}
+
+float VoxelBrush::get_distance(const Vector3 &p_point) const {
+	switch (shape) {
+		default:
+		case SHAPE_SPHERE:
+			return (p_point - position).length() - radius;
+		case SHAPE_BOX: {
+			Vector3 q = (p_point - position).abs() - extents;
+			Vector3 outside = Vector3(MAX(q.x, (real_t)0), MAX(q.y, (real_t)0), MAX(q.z, (real_t)0));
+			return outside.length() + MIN(MAX(q.x, MAX(q.y, q.z)), (real_t)0);
+		}
+		case SHAPE_CAPSULE: {
+			Vector3 pa = p_point - position;
+			Vector3 ba = end_position - position;
+			real_t ba_length_squared = ba.length_squared();
+			real_t h = ba_length_squared > 0 ? CLAMP(pa.dot(ba) / ba_length_squared, (real_t)0, (real_t)1) : 0;
+			return (pa - ba * h).length() - radius;
+		}
+	}
+}
+
+void VoxelBrush::get_row_distances(float p_x, float p_y, float p_z, size_t p_count, float *r_distances) const {
+	const Float4 zero = Float4::splat(0.0f);
+	switch (shape) {
+		default:
+		case SHAPE_SPHERE: {
+			// The Y and Z parts of the distance are the same for the whole row.
+			float dy = p_y - position.y;
+			float dz = p_z - position.z;
+			const Float4 dyz_squared = Float4::splat(dy * dy + dz * dz);
+			const Float4 r = Float4::splat(radius);
+			for (size_t i = 0; i < p_count; i += Float4::WIDTH) {
+				Float4 dx = Float4::ramp(p_x + i) - Float4::splat(position.x);
+				(util::sqrt(dx * dx + dyz_squared) - r).store(r_distances + i);
+			}
+		} break;
+		case SHAPE_BOX: {
+			float qy = Math::abs(p_y - position.y) - extents.y;
+			float qz = Math::abs(p_z - position.z) - extents.z;
+			const Float4 outside_yz_squared = Float4::splat(MAX(qy, 0.0f) * MAX(qy, 0.0f) + MAX(qz, 0.0f) * MAX(qz, 0.0f));
+			const Float4 qyz = Float4::splat(MAX(qy, qz));
+			for (size_t i = 0; i < p_count; i += Float4::WIDTH) {
+				Float4 qx = util::abs(Float4::ramp(p_x + i) - Float4::splat(position.x)) - Float4::splat(extents.x);
+				Float4 outside_x = util::max(qx, zero);
+				Float4 outside = util::sqrt(outside_x * outside_x + outside_yz_squared);
+				Float4 inside = util::min(util::max(qx, qyz), zero);
+				(outside + inside).store(r_distances + i);
+			}
+		} break;
+		case SHAPE_CAPSULE: {
+			Vector3 ba = end_position - position;
+			float ba_length_squared = ba.length_squared();
+			float inverse_ba_length_squared = ba_length_squared > 0 ? 1.0f / ba_length_squared : 0.0f;
+			float pay = p_y - position.y;
+			float paz = p_z - position.z;
+			const Float4 bax = Float4::splat(ba.x), bay = Float4::splat(ba.y), baz = Float4::splat(ba.z);
+			const Float4 pa_dot_ba_yz = Float4::splat(pay * ba.y + paz * ba.z);
+			const Float4 inverse = Float4::splat(inverse_ba_length_squared);
+			const Float4 one = Float4::splat(1.0f);
+			const Float4 r = Float4::splat(radius);
+			for (size_t i = 0; i < p_count; i += Float4::WIDTH) {
+				Float4 pax = Float4::ramp(p_x + i) - Float4::splat(position.x);
+				Float4 h = util::clamp((pax * bax + pa_dot_ba_yz) * inverse, zero, one);
+				Float4 dx = pax - bax * h;
+				Float4 dy = Float4::splat(pay) - bay * h;
+				Float4 dz = Float4::splat(paz) - baz * h;
+				(util::sqrt(dx * dx + dy * dy + dz * dz) - r).store(r_distances + i);
+			}
+		} break;
+	}
+
+	if (noise.is_valid() && noise_strength != 0) {
+		for (size_t i = 0; i < p_count; i++) {
+			r_distances[i] -= noise_strength * noise->get_noise_3d(p_x + i, p_y, p_z);
+		}
+	}
+}
+
+void VoxelBrush::blend_row(const float *p_distances, float p_constant_coverage, float *r_values, size_t p_count) const {
+	const Float4 zero = Float4::splat(0.0f);
+	const Float4 one = Float4::splat(1.0f);
+	const Float4 half = Float4::splat(0.5f);
+	const Float4 inverse_falloff = Float4::splat(1.0f / MAX(falloff, (real_t)CMP_EPSILON));
+	const Float4 brush_value = Float4::splat(value);
+
+	for (size_t i = 0; i < p_count; i += Float4::WIDTH) {
+		Float4 coverage = p_distances ?
+				util::clamp(half - Float4::load(p_distances + i) * inverse_falloff, zero, one) :
+				Float4::splat(p_constant_coverage);
+		Float4 existing = Float4::load(r_values + i);
+		Float4 result;
+		switch (operation) {
+			default:
+			case OPERATION_UNION:
+				result = util::max(existing, coverage * brush_value);
+				break;
+			// Subtract and Intersect scale against the larger of the existing and brush value,
+			// so that existing values above the brush value are left alone where the brush has no effect.
+			case OPERATION_SUBTRACT:
+				result = util::min(existing, (one - coverage) * util::max(existing, brush_value));
+				break;
+			case OPERATION_INTERSECT:
+				result = util::min(existing, coverage * util::max(existing, brush_value));
+				break;
+			case OPERATION_SMOOTH_BLEND: {
+				Float4 smooth_coverage = coverage * coverage * (Float4::splat(3.0f) - coverage * Float4::splat(2.0f));
+				result = existing + (brush_value - existing) * smooth_coverage;
+			} break;
+		}
+		result.store(r_values + i);
+	}
+}
+
+void VoxelBrush::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_shape"), &VoxelBrush::get_shape);
+	ClassDB::bind_method(D_METHOD("set_shape", "shape"), &VoxelBrush::set_shape);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "shape", PROPERTY_HINT_ENUM, "Sphere,Box,Capsule"),
+			"set_shape", "get_shape");
+
+	ClassDB::bind_method(D_METHOD("get_operation"), &VoxelBrush::get_operation);
+	ClassDB::bind_method(D_METHOD("set_operation", "operation"), &VoxelBrush::set_operation);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "operation", PROPERTY_HINT_ENUM, "Union,Subtract,Intersect,Smooth Blend"),
+			"set_operation", "get_operation");
+
+	ClassDB::bind_method(D_METHOD("get_position"), &VoxelBrush::get_position);
+	ClassDB::bind_method(D_METHOD("set_position", "position"), &VoxelBrush::set_position);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::VECTOR3, "position"),
+			"set_position", "get_position");
+
+	ClassDB::bind_method(D_METHOD("get_end_position"), &VoxelBrush::get_end_position);
+	ClassDB::bind_method(D_METHOD("set_end_position", "end_position"), &VoxelBrush::set_end_position);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::VECTOR3, "end_position"),
+			"set_end_position", "get_end_position");
+
+	ClassDB::bind_method(D_METHOD("get_extents"), &VoxelBrush::get_extents);
+	ClassDB::bind_method(D_METHOD("set_extents", "extents"), &VoxelBrush::set_extents);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::VECTOR3, "extents"),
+			"set_extents", "get_extents");
+
+	ClassDB::bind_method(D_METHOD("get_radius"), &VoxelBrush::get_radius);
+	ClassDB::bind_method(D_METHOD("set_radius", "radius"), &VoxelBrush::set_radius);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "radius", PROPERTY_HINT_RANGE, "0,256,0.01,or_greater"),
+			"set_radius", "get_radius");
+
+	ClassDB::bind_method(D_METHOD("get_falloff"), &VoxelBrush::get_falloff);
+	ClassDB::bind_method(D_METHOD("set_falloff", "falloff"), &VoxelBrush::set_falloff);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "falloff", PROPERTY_HINT_RANGE, "0,16,0.01,or_greater"),
+			"set_falloff", "get_falloff");
+
+	ClassDB::bind_method(D_METHOD("get_value"), &VoxelBrush::get_value);
+	ClassDB::bind_method(D_METHOD("set_value", "value"), &VoxelBrush::set_value);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "value"),
+			"set_value", "get_value");
+
+	ClassDB::bind_method(D_METHOD("get_noise"), &VoxelBrush::get_noise);
+	ClassDB::bind_method(D_METHOD("set_noise", "noise"), &VoxelBrush::set_noise);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "noise", PROPERTY_HINT_RESOURCE_TYPE, Noise::get_class_static()),
+			"set_noise", "get_noise");
+
+	ClassDB::bind_method(D_METHOD("get_noise_strength"), &VoxelBrush::get_noise_strength);
+	ClassDB::bind_method(D_METHOD("set_noise_strength", "noise_strength"), &VoxelBrush::set_noise_strength);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "noise_strength"),
+			"set_noise_strength", "get_noise_strength");
+
+	BIND_ENUM_CONSTANT(SHAPE_SPHERE)
+	BIND_ENUM_CONSTANT(SHAPE_BOX)
+	BIND_ENUM_CONSTANT(SHAPE_CAPSULE)
+
+	BIND_ENUM_CONSTANT(OPERATION_UNION)
+	BIND_ENUM_CONSTANT(OPERATION_SUBTRACT)
+	BIND_ENUM_CONSTANT(OPERATION_INTERSECT)
+	BIND_ENUM_CONSTANT(OPERATION_SMOOTH_BLEND)
+}
+
+VoxelBrush::VoxelBrush() {
+}
+
+VoxelBrush::~VoxelBrush() {
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <godot_cpp/core/binder_common.hpp>
+
+#include <godot_cpp/classes/noise.hpp>
+#include <godot_cpp/classes/ref.hpp>
+#include <godot_cpp/classes/resource.hpp>
+#include <godot_cpp/variant/aabb.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+using namespace godot;
+
+// A signed distance field shape that can be applied to a Voxel storage (see DynamicVoxelStorage::apply_brush).
+//
+// The brush converts the distance of every voxel into a coverage between 0 (outside) and 1 (inside),
+// with a linear falloff "falloff" voxels wide around the surface, and combines "value * coverage"
+// with the existing value of the chosen attribute component using "operation".
+// All positions and sizes are in voxels.
+class VoxelBrush : public Resource
+{
+	GDCLASS(VoxelBrush, Resource);
+
+protected:
+	static void _bind_methods();
+public:
+	enum Shape {
+		SHAPE_SPHERE,
+		SHAPE_BOX, // Axis aligned.
+		SHAPE_CAPSULE // From "position" to "end_position".
+	};
+
+	enum Operation {
+		OPERATION_UNION,
+		OPERATION_SUBTRACT,
+		OPERATION_INTERSECT,
+		OPERATION_SMOOTH_BLEND
+	};
+
+	Shape get_shape() const;
+	Operation get_operation() const;
+	Vector3 get_position() const;
+	Vector3 get_end_position() const;
+	Vector3 get_extents() const;
+	real_t get_radius() const;
+	real_t get_falloff() const;
+	real_t get_value() const;
+	Ref<Noise> get_noise() const;
+	real_t get_noise_strength() const;
+
+	void set_shape(Shape p_shape);
+	void set_operation(Operation p_operation);
+	void set_position(const Vector3 &p_position);
+	void set_end_position(const Vector3 &p_end_position);
+	void set_extents(const Vector3 &p_extents);
+	void set_radius(real_t p_radius);
+	void set_falloff(real_t p_falloff);
+	void set_value(real_t p_value);
+	void set_noise(const Ref<Noise> &p_noise);
+	void set_noise_strength(real_t p_noise_strength);
+
+	// How far outside of the shape's surface the brush can still have an effect (falloff and noise displacement).
+	float get_margin() const;
+	// The bounds of everything the brush can affect.
+	AABB get_bounds() const;
+
+	// The exact signed distance to the shape, without the noise displacement.
+	float get_distance(const Vector3 &p_point) const;
+	// Writes the signed distances of a row of voxels going along the X axis starting at "p_x" (noise displacement included).
+	// "r_distances" must have room for "p_count" rounded up to a multiple of util::Float4::WIDTH,
+	// the padding gets written with garbage.
+	void get_row_distances(float p_x, float p_y, float p_z, size_t p_count, float *r_distances) const;
+
+	// Combines a row of existing values with the brush according to "operation".
+	// Uses "p_distances" when given, otherwise every voxel of the row gets the coverage "p_constant_coverage".
+	// Both arrays must be padded the same way as for get_row_distances().
+	void blend_row(const float *p_distances, float p_constant_coverage, float *r_values, size_t p_count) const;
+
+	VoxelBrush();
+	~VoxelBrush();
+protected:
+	Shape shape = SHAPE_SPHERE;
+	Operation operation = OPERATION_UNION;
+	Vector3 position;
+	Vector3 end_position;
+	Vector3 extents = Vector3(1, 1, 1);
+	real_t radius = 1;
+	real_t falloff = 1;
+	real_t value = 1;
+
+	Ref<Noise> noise;
+	real_t noise_strength = 0;
+};
+
+VARIANT_ENUM_CAST(VoxelBrush::Shape)
+VARIANT_ENUM_CAST(VoxelBrush::Operation)
@@ -0,0 +1,159 @@
+#include "voxel_statistics.hpp"
+
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/performance.hpp>
+
+using namespace godot;
+
+VoxelStatistics *VoxelStatistics::singleton = nullptr;
+
+std::mutex VoxelStatistics::storages_mutex;
+LocalVector<const VoxelStorageCounters *> VoxelStatistics::storages;
+
+void VoxelStatistics::register_storage(const VoxelStorageCounters *p_counters) {
+	std::lock_guard<std::mutex> lock(storages_mutex);
+	storages.push_back(p_counters);
+}
+
+void VoxelStatistics::unregister_storage(const VoxelStorageCounters *p_counters) {
+	std::lock_guard<std::mutex> lock(storages_mutex);
+	storages.erase(p_counters);
+}
+
+uint64_t VoxelStatistics::_sum(std::atomic<uint64_t> VoxelStorageCounters::*p_counter) const {
+	std::lock_guard<std::mutex> lock(storages_mutex);
+	uint64_t result = 0;
+	for (const VoxelStorageCounters *counters : storages) {
+		result += VoxelStorageCounters::get(counters->*p_counter);
+	}
+	return result;
+}
+
+double VoxelStatistics::_get_per_frame(uint64_t p_value, PerFrameSample &p_sample) {
+	uint64_t frame = Engine::get_singleton()->get_process_frames();
+	// Anything else polling the monitor (e.g. Performance.get_custom_monitor() from a script) would otherwise skew the rate.
+	if (frame == p_sample.frame) return p_sample.rate;
+
+	// Storages can be freed in between polls, which would make the counter go backwards.
+	uint64_t delta = p_value > p_sample.value ? p_value - p_sample.value : 0;
+	uint64_t frames = MAX(frame - p_sample.frame, (uint64_t)1);
+	p_sample.value = p_value;
+	p_sample.frame = frame;
+	p_sample.rate = (double)delta / (double)frames;
+	return p_sample.rate;
+}
+
+uint64_t VoxelStatistics::get_allocated_chunks() const {
+	return _sum(&VoxelStorageCounters::allocated_chunks);
+}
+
+uint64_t VoxelStatistics::get_reusable_chunks() const {
+	return _sum(&VoxelStorageCounters::reusable_chunks);
+}
+
+uint64_t VoxelStatistics::get_allocated_bytes() const {
+	std::lock_guard<std::mutex> lock(storages_mutex);
+	uint64_t result = 0;
+	for (const VoxelStorageCounters *counters : storages) {
+		result += VoxelStorageCounters::get(counters->allocated_chunks) * VoxelStorageCounters::get(counters->chunk_byte_size);
+	}
+	return result;
+}
+
+uint64_t VoxelStatistics::get_reusable_bytes() const {
+	std::lock_guard<std::mutex> lock(storages_mutex);
+	uint64_t result = 0;
+	for (const VoxelStorageCounters *counters : storages) {
+		result += VoxelStorageCounters::get(counters->reusable_chunks) * VoxelStorageCounters::get(counters->chunk_byte_size);
+	}
+	return result;
+}
+
+double VoxelStatistics::get_voxel_writes_per_frame() {
+	return _get_per_frame(_sum(&VoxelStorageCounters::voxel_writes), voxel_writes_sample);
+}
+
+double VoxelStatistics::get_chunk_allocations_per_frame() {
+	return _get_per_frame(
+			_sum(&VoxelStorageCounters::chunk_allocations) + _sum(&VoxelStorageCounters::chunk_reuses), 
+			chunk_allocations_sample);
+}
+
+double VoxelStatistics::get_chunk_frees_per_frame() {
+	return _get_per_frame(_sum(&VoxelStorageCounters::chunk_frees), chunk_frees_sample);
+}
+
+double VoxelStatistics::get_allocation_time_msec() const {
+	return _sum(&VoxelStorageCounters::allocation_time_nsec) / 1000000.0;
+}
+
+double VoxelStatistics::get_bulk_time_msec() const {
+	return _sum(&VoxelStorageCounters::bulk_time_nsec) / 1000000.0;
+}
+
+// Monitor ids, "category/name" as expected by Performance.
+static const char *MONITOR_ALLOCATED_CHUNKS = "Vodot/Allocated Chunks";
+static const char *MONITOR_REUSABLE_CHUNKS = "Vodot/Reusable Chunks";
+static const char *MONITOR_ALLOCATED_BYTES = "Vodot/Allocated Bytes";
+static const char *MONITOR_REUSABLE_BYTES = "Vodot/Reusable Bytes";
+static const char *MONITOR_VOXEL_WRITES = "Vodot/Voxel Writes per Frame";
+static const char *MONITOR_CHUNK_ALLOCATIONS = "Vodot/Chunk Allocations per Frame";
+static const char *MONITOR_CHUNK_FREES = "Vodot/Chunk Frees per Frame";
+static const char *MONITOR_ALLOCATION_TIME = "Vodot/Allocation Time (ms)";
+static const char *MONITOR_BULK_TIME = "Vodot/Bulk Time (ms)";
+
+void VoxelStatistics::add_monitors() {
+	singleton = memnew(VoxelStatistics);
+
+	Performance *performance = Performance::get_singleton();
+	performance->add_custom_monitor(MONITOR_ALLOCATED_CHUNKS, Callable(singleton, "get_allocated_chunks"));
+	performance->add_custom_monitor(MONITOR_REUSABLE_CHUNKS, Callable(singleton, "get_reusable_chunks"));
+	performance->add_custom_monitor(MONITOR_ALLOCATED_BYTES, Callable(singleton, "get_allocated_bytes"));
+	performance->add_custom_monitor(MONITOR_REUSABLE_BYTES, Callable(singleton, "get_reusable_bytes"));
+	performance->add_custom_monitor(MONITOR_VOXEL_WRITES, Callable(singleton, "get_voxel_writes_per_frame"));
+	performance->add_custom_monitor(MONITOR_CHUNK_ALLOCATIONS, Callable(singleton, "get_chunk_allocations_per_frame"));
+	performance->add_custom_monitor(MONITOR_CHUNK_FREES, Callable(singleton, "get_chunk_frees_per_frame"));
+#ifdef VODOT_PROFILING
+	performance->add_custom_monitor(MONITOR_ALLOCATION_TIME, Callable(singleton, "get_allocation_time_msec"));
+	performance->add_custom_monitor(MONITOR_BULK_TIME, Callable(singleton, "get_bulk_time_msec"));
+#endif
+}
+
+void VoxelStatistics::remove_monitors() {
+	Performance *performance = Performance::get_singleton();
+	performance->remove_custom_monitor(MONITOR_ALLOCATED_CHUNKS);
+	performance->remove_custom_monitor(MONITOR_REUSABLE_CHUNKS);
+	performance->remove_custom_monitor(MONITOR_ALLOCATED_BYTES);
+	performance->remove_custom_monitor(MONITOR_REUSABLE_BYTES);
+	performance->remove_custom_monitor(MONITOR_VOXEL_WRITES);
+	performance->remove_custom_monitor(MONITOR_CHUNK_ALLOCATIONS);
+	performance->remove_custom_monitor(MONITOR_CHUNK_FREES);
+#ifdef VODOT_PROFILING
+	performance->remove_custom_monitor(MONITOR_ALLOCATION_TIME);
+	performance->remove_custom_monitor(MONITOR_BULK_TIME);
+#endif
+
+	memdelete(singleton);
+	singleton = nullptr;
+}
+
+void VoxelStatistics::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_allocated_chunks"), &VoxelStatistics::get_allocated_chunks);
+	ClassDB::bind_method(D_METHOD("get_reusable_chunks"), &VoxelStatistics::get_reusable_chunks);
+	ClassDB::bind_method(D_METHOD("get_allocated_bytes"), &VoxelStatistics::get_allocated_bytes);
+	ClassDB::bind_method(D_METHOD("get_reusable_bytes"), &VoxelStatistics::get_reusable_bytes);
+
+	ClassDB::bind_method(D_METHOD("get_voxel_writes_per_frame"), &VoxelStatistics::get_voxel_writes_per_frame);
+	ClassDB::bind_method(D_METHOD("get_chunk_allocations_per_frame"), &VoxelStatistics::get_chunk_allocations_per_frame);
+	ClassDB::bind_method(D_METHOD("get_chunk_frees_per_frame"), &VoxelStatistics::get_chunk_frees_per_frame);
+
+	ClassDB::bind_method(D_METHOD("get_allocation_time_msec"), &VoxelStatistics::get_allocation_time_msec);
+	ClassDB::bind_method(D_METHOD("get_bulk_time_msec"), &VoxelStatistics::get_bulk_time_msec);
+}
+
+VoxelStatistics::VoxelStatistics() {
+}
+
+VoxelStatistics::~VoxelStatistics() {
+}
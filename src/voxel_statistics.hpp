@@ -0,0 +1,113 @@
+#pragma once
+
+#include <godot_cpp/classes/object.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+using namespace godot;
+
+// Counters kept by every Voxel storage.
+// These are all relaxed atomics, so they are cheap enough to leave on in release builds
+// and can safely be read from other threads (e.g. by the Performance monitors) while the storage is being edited.
+struct VoxelStorageCounters {
+	// Ever increasing event counters.
+	std::atomic<uint64_t> voxel_writes = 0;
+	std::atomic<uint64_t> chunk_allocations = 0; // New chunks appended to the end of the attribute buffers.
+	std::atomic<uint64_t> chunk_reuses = 0; // Chunks popped off of the reusable chunk queue.
+	std::atomic<uint64_t> chunk_frees = 0; // Chunks pushed onto the reusable chunk queue.
+
+	// Current state of the storage.
+	std::atomic<uint64_t> allocated_chunks = 0;
+	std::atomic<uint64_t> reusable_chunks = 0;
+	std::atomic<uint64_t> chunk_byte_size = 0; // The size of a single chunk summed over all attributes.
+
+	// Only updated when built with "profiling=yes" (see VODOT_SCOPED_TIMER).
+	std::atomic<uint64_t> allocation_time_nsec = 0;
+	std::atomic<uint64_t> bulk_time_nsec = 0;
+
+	_ALWAYS_INLINE_ static void add(std::atomic<uint64_t> &p_counter, uint64_t p_amount = 1) {
+		p_counter.fetch_add(p_amount, std::memory_order_relaxed);
+	}
+
+	_ALWAYS_INLINE_ static void set(std::atomic<uint64_t> &p_counter, uint64_t p_value) {
+		p_counter.store(p_value, std::memory_order_relaxed);
+	}
+
+	_ALWAYS_INLINE_ static uint64_t get(const std::atomic<uint64_t> &p_counter) {
+		return p_counter.load(std::memory_order_relaxed);
+	}
+};
+
+// Adds the time spent in the current scope to a counter.
+class VoxelScopedTimer {
+	std::atomic<uint64_t> &counter;
+	std::chrono::steady_clock::time_point start;
+public:
+	_ALWAYS_INLINE_ VoxelScopedTimer(std::atomic<uint64_t> &p_counter) :
+			counter(p_counter), start(std::chrono::steady_clock::now()) {}
+	_ALWAYS_INLINE_ ~VoxelScopedTimer() {
+		VoxelStorageCounters::add(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+// Scoped timers are only compiled in when profiling is enabled ("scons profiling=yes"),
+// as unlike the counters, reading the clock isn't free.
+#ifdef VODOT_PROFILING
+#define VODOT_SCOPED_TIMER(m_counter) VoxelScopedTimer _scoped_timer(m_counter)
+#else
+#define VODOT_SCOPED_TIMER(m_counter)
+#endif
+
+// Aggregates the counters of every live Voxel storage and exposes them as custom Performance monitors
+// (under the "Vodot" category of the debugger's Monitors tab).
+class VoxelStatistics : public Object
+{
+	GDCLASS(VoxelStatistics, Object);
+
+	static VoxelStatistics *singleton;
+
+	static std::mutex storages_mutex;
+	static LocalVector<const VoxelStorageCounters *> storages;
+
+	// Used to turn the ever increasing counters into a per-frame average since the monitor was last sampled.
+	// Sampled at most once per frame, other polls within the same frame get the cached rate.
+	struct PerFrameSample {
+		uint64_t value = 0;
+		uint64_t frame = 0;
+		double rate = 0.0;
+	};
+	PerFrameSample voxel_writes_sample;
+	PerFrameSample chunk_allocations_sample;
+	PerFrameSample chunk_frees_sample;
+
+	double _get_per_frame(uint64_t p_value, PerFrameSample &p_sample);
+	uint64_t _sum(std::atomic<uint64_t> VoxelStorageCounters::*p_counter) const;
+
+protected:
+	static void _bind_methods();
+public:
+	static void register_storage(const VoxelStorageCounters *p_counters);
+	static void unregister_storage(const VoxelStorageCounters *p_counters);
+
+	// Called from the extension initialization / termination.
+	static void add_monitors();
+	static void remove_monitors();
+
+	uint64_t get_allocated_chunks() const;
+	uint64_t get_reusable_chunks() const;
+	uint64_t get_allocated_bytes() const;
+	uint64_t get_reusable_bytes() const;
+
+	double get_voxel_writes_per_frame();
+	double get_chunk_allocations_per_frame();
+	double get_chunk_frees_per_frame();
+
+	double get_allocation_time_msec() const;
+	double get_bulk_time_msec() const;
+
+	VoxelStatistics();
+	~VoxelStatistics();
+};